@@ -0,0 +1,31 @@
+// File: allocations.c | Linked into: oss
+//
+// Counts heap allocations made by OSS's own code, so a run can show that its main loop allocates
+// nothing once it is up. The Makefile links OSS with -Wl,--wrap for malloc, calloc and realloc,
+// which sends every call from OSS's object files through the wrappers below. Allocations made
+// inside the C library itself (stdio buffers, for one) are not counted.
+
+#include <stddef.h>
+
+#include "allocations.h"
+
+unsigned long heapAllocations = 0;
+
+void *__real_malloc ( size_t size );
+void *__real_calloc ( size_t count, size_t size );
+void *__real_realloc ( void *pointer, size_t size );
+
+void *__wrap_malloc ( size_t size ) {
+	heapAllocations++;
+	return __real_malloc ( size );
+}
+
+void *__wrap_calloc ( size_t count, size_t size ) {
+	heapAllocations++;
+	return __real_calloc ( count, size );
+}
+
+void *__wrap_realloc ( void *pointer, size_t size ) {
+	heapAllocations++;
+	return __real_realloc ( pointer, size );
+}
@@ -0,0 +1,12 @@
+
+// File: allocations.h
+//
+// Header file for the heap allocation counter (see allocations.c)
+
+#ifndef ALLOCATIONS_HEADER_FILE
+#define ALLOCATIONS_HEADER_FILE
+
+// Calls to malloc, calloc and realloc made by the program's own code so far
+extern unsigned long heapAllocations;
+
+#endif
@@ -0,0 +1,54 @@
+
+// File: banker.h
+//
+// Header file for the banker's algorithm safety kernels used by the resource manager (resmgr.c)
+
+#ifndef BANKER_HEADER_FILE
+#define BANKER_HEADER_FILE
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sizes.h"
+
+// Signature shared by the generic safety check and every specialized kernel
+typedef bool ( *SafetyKernel ) ( int available[], int maximum[][maxResources], int allot[][maxResources] );
+
+// Passes over the process table made by the most recent safety check (reported by the safety_end tracepoint)
+extern int safetyCheckPasses;
+
+// Resource vector width from which selectSafetyKernel() picks the sparse check over a dense scan
+#define sparseNeedMinWidth 8
+
+// Process slot count from which selectSafetyKernel() picks the queued check
+#define queuedMinProcesses 1024
+
+// Sparse need masks for one set of tables (see banker.c)
+#define sparseMaskWords ( ( maxResources + 63 ) / 64 )
+typedef struct {
+	uint64_t needMask[maxProcesses][sparseMaskWords];
+	uint64_t blockerMask[maxProcesses][sparseMaskWords];
+	uint64_t heldMask[maxProcesses][sparseMaskWords];
+	bool enabled;	// True once sparseNeedRebuild() has run; the masks are only maintained after that
+} SparseNeed;
+
+/* Function Prototypes */
+void calculateNeed ( int need[maxProcesses][maxResources], int maximum[maxProcesses][maxResources], int allot[maxProcesses][maxResources] );
+bool isSafeStateGeneric ( int available[], int maximum[][maxResources], int allot[][maxResources] );
+SafetyKernel selectSafetyKernel ( int numResources, int largestCellValue );
+SafetyKernel selectDenseSafetyKernel ( int numResources, int largestCellValue );
+const char *safetyKernelName ( SafetyKernel kernel );
+void findSafetyBlockers ( int available[], int maximum[][maxResources], int allot[][maxResources], bool blockers[] );
+void lastCheckBlockers ( int maximum[][maxResources], int allot[][maxResources], bool blockers[] );
+
+// Sparse need representation (see banker.c)
+void sparseNeedUse ( SparseNeed *sparseNeed );
+bool isSafeStateSparse ( int available[], int maximum[][maxResources], int allot[][maxResources] );
+void sparseNeedRebuild ( int maximum[][maxResources], int allot[][maxResources], int available[] );
+void sparseNeedCellChanged ( int process, int resource, int maximum[][maxResources], int allot[][maxResources], int available[] );
+void sparseNeedAvailableChanged ( int resource, int maximum[][maxResources], int allot[][maxResources], int available[] );
+
+// Queued safety check for large process tables (see banker.c)
+bool isSafeStateQueued ( int available[], int maximum[][maxResources], int allot[][maxResources] );
+
+#endif
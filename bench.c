@@ -0,0 +1,776 @@
+// File: bench.c | Executable: bench
+//
+// Microbenchmarks for the functions on OSS's request path: the banker's safety check (every kernel
+// OSS can pick, plus the blocker scan OSS runs after an unsafe answer), calculateNeed(), the blocked
+// queue and incrementClock(), and whole requests through the resource manager library (resmgr.c).
+// States are generated for every combination of live process count (-p) and load factor (-l), with
+// the requested share of unsafe states (-u); -r and -c widen the drawn totals and claims. Every
+// benchmark is warmed up, calibrated so a trial takes at least -m milliseconds, then timed over -t
+// trials. The median and best ns/op are reported, along with operations per second (checks per
+// second for the safety kernels) and heap allocations per op.
+// With -o the results are appended to a CSV file; with -b they are compared against such a file and
+// bench exits 1 if anything got more than -x percent slower.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+
+#include "resmgr.h"
+#include "simclock.h"
+#include "allocations.h"
+
+#define maxListItems 16		// Most values accepted for -p and -l
+#define benchCsvHeader "benchmark,variant,processes,loadPct,unsafePct,nsPerOpMedian,nsPerOpBest,opsPerSecond,allocationsPerOp"
+
+// One generated resource manager state, laid out like OSS's tables
+typedef struct {
+	int available[maxResources];
+	int maximum[maxProcesses][maxResources];
+	int allot[maxProcesses][maxResources];
+	bool safe;		// Answer of the generic check
+	int requestProcess;	// The tentative request included in the tables, -1 if there is none
+	int requestResource;
+} BenchState;
+
+// Timed part of a benchmark: does repetitions rounds of its operation and returns the nanoseconds spent.
+// Set up that shouldn't be timed (like rebuilding the sparse masks for each state) happens outside the clock.
+typedef long long ( *BenchBody ) ( long repetitions );
+
+// One line of results
+typedef struct {
+	const char *benchmark;
+	const char *variant;
+	int processes;		// 0 where the benchmark doesn't depend on the state
+	int loadPercent;
+	int unsafePercent;
+	double nsPerOpMedian;
+	double nsPerOpBest;
+	double allocationsPerOp;
+} BenchResult;
+
+void splitList ( int values[], int *count, char *flag, char *text );
+int generateStates ( int processes, int loadPercent, int unsafePercent );
+bool runBenchmark ( BenchResult *result, BenchBody body, long opsPerRepetition );
+void reportResult ( BenchResult *result );
+int compareDouble ( const void *a, const void *b );
+long long elapsedNs ( struct timespec *start );
+long long benchKernel ( long repetitions );
+long long benchBlockers ( long repetitions );
+long long benchLastCheckBlockers ( long repetitions );
+long long benchCalculateNeed ( long repetitions );
+long long benchQueue ( long repetitions );
+long long benchClock ( long repetitions );
+long long benchClockCompare ( long repetitions );
+long long benchGrant ( long repetitions );
+long long benchRetry ( long repetitions );
+void loadManager ( BenchState *state );
+void incrementClockCompare ( unsigned int clock[] );
+void printUsage ( char *name );
+
+// Benchmark settings
+int trials = 5;			// Timed trials per benchmark
+int warmupTrials = 1;		// Untimed trials before them
+long long minTrialNs = 10000000;	// Shortest trial; repetitions are doubled until a trial takes this long
+FILE *csvFp = NULL;		// -o output, if any
+char *baselineName = NULL;	// -b baseline to compare against, if any
+double regressionPercent = 10.0;	// -x slowdown over the baseline that counts as a regression
+int regressions = 0;
+
+// Generated states and what the current benchmark runs over
+BenchState *states;
+int stateCount = 0;
+int statesWanted = 64;
+int largestTotal = 10;		// -r: totals are drawn from 1 to this
+int largestClaim = 4;		// -c: claims are drawn from 1 to this
+SafetyKernel benchedKernel;	// Kernel benchKernel() times
+int need[maxProcesses][maxResources];	// Output of benchCalculateNeed()
+Queue *benchQueueHandle;
+int queueDepth;			// Items kept in the queue while benchQueue() runs
+int mismatches = 0;		// Kernel answers that disagreed with the generic check
+ResourceManager benchManager;	// Manager the resmgr benchmarks drive
+int requestVector[maxResources];	// One unit of the state's requested resource
+
+int main ( int argc, char *argv[] ) {
+	int processList[maxListItems];
+	int loadList[maxListItems];
+	int processCount, loadCount;
+	int unsafePercent = 50;
+	unsigned int seed = 1;
+	char *outputName = NULL;
+	BenchResult result;
+	int emptyTotals[maxResources] = { 0 };
+	int option;
+	int p, l;
+
+	splitList ( processList, &processCount, "-p", "10,50,100" );
+	splitList ( loadList, &loadCount, "-l", "25,50,90" );
+
+	/* Command line options */
+	while ( ( option = getopt ( argc, argv, "hp:l:u:n:r:c:t:w:m:s:o:b:x:" ) ) != -1 ) {
+		switch ( option ) {
+			case 'h':
+				printUsage ( argv[0] );
+				return 0;
+			case 'p':
+				splitList ( processList, &processCount, "-p", optarg );
+				break;
+			case 'l':
+				splitList ( loadList, &loadCount, "-l", optarg );
+				break;
+			case 'u':
+				unsafePercent = atoi ( optarg );
+				break;
+			case 'n':
+				statesWanted = atoi ( optarg );
+				break;
+			case 'r':
+				largestTotal = atoi ( optarg );
+				break;
+			case 'c':
+				largestClaim = atoi ( optarg );
+				break;
+			case 't':
+				trials = atoi ( optarg );
+				break;
+			case 'w':
+				warmupTrials = atoi ( optarg );
+				break;
+			case 'm':
+				minTrialNs = atoll ( optarg ) * 1000000LL;
+				break;
+			case 's':
+				seed = atoi ( optarg );
+				break;
+			case 'o':
+				outputName = optarg;
+				break;
+			case 'b':
+				baselineName = optarg;
+				break;
+			case 'x':
+				regressionPercent = atof ( optarg );
+				break;
+			default:
+				printUsage ( argv[0] );
+				return 1;
+		}
+	}
+
+	if ( unsafePercent < 0 || unsafePercent > 100 || statesWanted < 1 || trials < 1 || warmupTrials < 0 || minTrialNs < 1 ) {
+		fprintf ( stderr, "BENCH: -u must be 0-100, -n -t and -m at least 1, and -w at least 0.\n" );
+		return 1;
+	}
+	if ( largestTotal < 1 || largestClaim < 1 ) {
+		fprintf ( stderr, "BENCH: -r and -c must be at least 1.\n" );
+		return 1;
+	}
+	for ( p = 0; p < processCount; ++p ) {
+		if ( processList[p] < 1 || processList[p] > maxProcesses ) {
+			fprintf ( stderr, "BENCH: -p values must be 1-%d (maxProcesses).\n", maxProcesses );
+			return 1;
+		}
+	}
+	for ( l = 0; l < loadCount; ++l ) {
+		if ( loadList[l] < 0 || loadList[l] > 100 ) {
+			fprintf ( stderr, "BENCH: -l values must be 0-100.\n" );
+			return 1;
+		}
+	}
+
+	if ( ( states = malloc ( statesWanted * sizeof ( BenchState ) ) ) == NULL ) {
+		perror ( "BENCH: Failure to allocate the benchmark states." );
+		return 1;
+	}
+	if ( outputName != NULL ) {
+		if ( ( csvFp = fopen ( outputName, "a" ) ) == NULL ) {
+			perror ( "BENCH: Failure to open the output file." );
+			return 1;
+		}
+		if ( ftell ( csvFp ) == 0 )
+			fprintf ( csvFp, "%s\n", benchCsvHeader );
+	}
+	srand ( seed );
+	if ( !resmgrInit ( &benchManager, emptyTotals ) ) {
+		fprintf ( stderr, "BENCH: Failure to set up the resource manager.\n" );
+		return 1;
+	}
+
+	printf ( "%-16s %-14s %6s %5s %7s %14s %14s %14s %10s\n", "Benchmark", "Variant", "Procs", "Load", "Unsafe",
+		 "ns/op median", "ns/op best", "ops/sec", "allocs/op" );
+
+	// The clock doesn't depend on the table, so it is timed once
+	memset ( &result, 0, sizeof ( result ) );
+	result.benchmark = "incrementClock";
+	result.variant = "divide";
+	if ( runBenchmark ( &result, benchClock, 1 ) )
+		reportResult ( &result );
+	result.variant = "compare";
+	if ( runBenchmark ( &result, benchClockCompare, 1 ) )
+		reportResult ( &result );
+
+	for ( p = 0; p < processCount; ++p ) {
+		// Blocked queue holding every live process, one enqueue and dequeue per op
+		memset ( &result, 0, sizeof ( result ) );
+		result.benchmark = "queue";
+		result.variant = "enqueue+dequeue";
+		result.processes = processList[p];
+		queueDepth = processList[p];
+		benchQueueHandle = createQueue ( maxProcesses );
+		for ( l = 0; l < queueDepth - 1; ++l ) {
+			enqueue ( benchQueueHandle, l );
+		}
+		if ( runBenchmark ( &result, benchQueue, 1 ) )
+			reportResult ( &result );
+		destroyQueue ( benchQueueHandle );
+
+		for ( l = 0; l < loadCount; ++l ) {
+			SafetyKernel kernels[4];
+			int largestCellValue = 0;
+			int unsafeCount = 0;
+			int grantable = 0, blockable = 0;	// States with a request the manager grants / blocks
+			int s, i, j, k;
+
+			if ( generateStates ( processList[p], loadList[l], unsafePercent ) == -1 )
+				return 1;
+			for ( s = 0; s < stateCount; ++s ) {
+				if ( !states[s].safe )
+					unsafeCount++;
+				if ( states[s].requestProcess != -1 ) {
+					if ( states[s].safe )
+						grantable++;
+					else
+						blockable++;
+				}
+				// The dense kernels hold the work vector in the cell type too, so the bound covers
+				//   each resource's total as well as the claims, as in resmgrSelectKernel()
+				for ( j = 0; j < maxResources; ++j ) {
+					int total = states[s].available[j];
+
+					for ( i = 0; i < maxProcesses; ++i ) {
+						total += states[s].allot[i][j];
+						if ( states[s].maximum[i][j] > largestCellValue )
+							largestCellValue = states[s].maximum[i][j];
+					}
+					if ( total > largestCellValue )
+						largestCellValue = total;
+				}
+			}
+
+			memset ( &result, 0, sizeof ( result ) );
+			result.processes = processList[p];
+			result.loadPercent = loadList[l];
+			result.unsafePercent = unsafeCount * 100 / stateCount;
+
+			// Every kernel OSS can pick for this table, the generic one first as the reference
+			kernels[0] = isSafeStateGeneric;
+			kernels[1] = selectDenseSafetyKernel ( maxResources, largestCellValue );
+			kernels[2] = isSafeStateSparse;
+			kernels[3] = isSafeStateQueued;
+			result.benchmark = "safety check";
+			for ( k = 0; k < 4; ++k ) {
+				if ( k == 1 && kernels[1] == isSafeStateGeneric )
+					continue;	// No dense kernel fits this width
+				benchedKernel = kernels[k];
+				result.variant = safetyKernelName ( kernels[k] );
+				if ( runBenchmark ( &result, benchKernel, stateCount ) )
+					reportResult ( &result );
+			}
+
+			// The blocker scan only runs after an unsafe answer
+			result.benchmark = "safety blockers";
+			result.variant = "unsafe only";
+			if ( unsafeCount > 0 && runBenchmark ( &result, benchBlockers, unsafeCount ) )
+				reportResult ( &result );
+			result.variant = "from check";
+			if ( unsafeCount > 0 && runBenchmark ( &result, benchLastCheckBlockers, unsafeCount ) )
+				reportResult ( &result );
+
+			result.benchmark = "calculateNeed";
+			result.variant = "full table";
+			if ( runBenchmark ( &result, benchCalculateNeed, stateCount ) )
+				reportResult ( &result );
+
+			// The state's request through the library, as OSS makes it: granted and released again
+			//   in the safe states, retried from the blocked queue and denied again in the unsafe ones
+			result.benchmark = "resmgr";
+			result.variant = "grant+release";
+			if ( grantable > 0 && runBenchmark ( &result, benchGrant, grantable ) )
+				reportResult ( &result );
+			result.variant = "blocked retry";
+			if ( blockable > 0 && runBenchmark ( &result, benchRetry, blockable ) )
+				reportResult ( &result );
+		}
+	}
+
+	resmgrDestroy ( &benchManager );
+	if ( csvFp != NULL )
+		fclose ( csvFp );
+	if ( mismatches > 0 )
+		fprintf ( stderr, "BENCH: %d kernel answers disagreed with the generic check.\n", mismatches );
+	if ( regressions > 0 )
+		fprintf ( stderr, "BENCH: %d benchmarks more than %.1f%% slower than %s.\n", regressions, regressionPercent, baselineName );
+
+	return mismatches > 0 || regressions > 0;
+}
+
+// Fills states with statesWanted random states shaped like the ones OSS checks: units are granted
+//   to random live processes, each grant kept only if the state stays safe (as OSS's banker does),
+//   until loadPercent of the resources are out or no more grants fit. Then one more unit is handed
+//   out tentatively, the request OSS would be checking, chosen so that unsafePercent of the states
+//   end up unsafe where the table allows it.
+// Totals and claims are drawn like OSS's defaults (1-10 of each resource, claims of 1-4) unless -r and
+//   -c widen them, but a claim never exceeds the total, since such a process could never finish and
+//   every check would fail. Wide claims are granted a few units at a time, so the load is reached
+//   in about as many checks as with OSS's.
+// Returns the number of states, or -1 if none could be generated.
+int generateStates ( int processes, int loadPercent, int unsafePercent ) {
+	int unsafeWanted = ( statesWanted * unsafePercent + 50 ) / 100;
+	int unsafeCount = 0;
+	int grantStep = largestClaim > 4 ? largestClaim / 4 : 1;	// Most units handed out per grant
+	int total[maxResources];
+	BenchState *state;
+	int s, i, j, tries;
+
+	for ( s = 0; s < statesWanted; ++s ) {
+		bool wantUnsafe = s < unsafeWanted;
+		int target = 0, allocated = 0;
+		int units;
+
+		state = &states[s];
+		memset ( state, 0, sizeof ( BenchState ) );
+		for ( j = 0; j < maxResources; ++j ) {
+			total[j] = rand() % largestTotal + 1;
+			state->available[j] = total[j];
+			target += total[j] * loadPercent / 100;
+		}
+		for ( i = 0; i < processes; ++i ) {
+			for ( j = 0; j < maxResources; ++j ) {
+				state->maximum[i][j] = rand() % largestClaim + 1;
+				if ( state->maximum[i][j] > total[j] )
+					state->maximum[i][j] = total[j];
+			}
+		}
+
+		// Safe grants up to the load
+		for ( tries = 0; allocated < target && tries < 4 * target / grantStep + 64; ++tries ) {
+			i = rand() % processes;
+			j = rand() % maxResources;
+			if ( state->allot[i][j] == state->maximum[i][j] || state->available[j] == 0 )
+				continue;
+			units = grantStep > 1 ? rand() % grantStep + 1 : 1;
+			if ( units > state->maximum[i][j] - state->allot[i][j] )
+				units = state->maximum[i][j] - state->allot[i][j];
+			if ( units > state->available[j] )
+				units = state->available[j];
+			state->allot[i][j] += units;
+			state->available[j] -= units;
+			if ( isSafeStateGeneric ( state->available, state->maximum, state->allot ) ) {
+				allocated += units;
+			} else {
+				state->allot[i][j] -= units;
+				state->available[j] += units;
+			}
+		}
+
+		// The request being checked: look for one with the wanted answer, settle for any other
+		int requestProcess = -1, requestResource = -1;
+		for ( tries = 0; tries < 64 * maxResources; ++tries ) {
+			i = rand() % processes;
+			j = rand() % maxResources;
+			if ( state->allot[i][j] == state->maximum[i][j] || state->available[j] == 0 )
+				continue;
+			requestProcess = i;
+			requestResource = j;
+			state->allot[i][j]++;
+			state->available[j]--;
+			if ( isSafeStateGeneric ( state->available, state->maximum, state->allot ) != wantUnsafe )
+				break;
+			state->allot[i][j]--;
+			state->available[j]++;
+		}
+		if ( tries == 64 * maxResources && requestProcess != -1 ) {
+			state->allot[requestProcess][requestResource]++;
+			state->available[requestResource]--;
+		}
+		state->requestProcess = requestProcess;
+		state->requestResource = requestResource;
+
+		state->safe = isSafeStateGeneric ( state->available, state->maximum, state->allot );
+		if ( !state->safe )
+			unsafeCount++;
+	}
+
+	stateCount = statesWanted;
+	if ( unsafeCount != unsafeWanted )
+		fprintf ( stderr, "BENCH: %d of %d states at %d processes and %d%% load are unsafe (wanted %d).\n",
+			 unsafeCount, stateCount, processes, loadPercent, unsafeWanted );
+	return stateCount;
+}
+
+// Warms up, calibrates and times one benchmark, filling in the timing fields of result.
+// Returns false if the benchmark couldn't be timed.
+bool runBenchmark ( BenchResult *result, BenchBody body, long opsPerRepetition ) {
+	double nsPerOp[trials];
+	long repetitions = 1;
+	unsigned long allocationsBefore;
+	int i;
+
+	// Double the repetitions until a trial is long enough to time, then warm up at that length
+	while ( body ( repetitions ) < minTrialNs ) {
+		repetitions *= 2;
+		if ( repetitions > ( 1L << 40 ) )
+			return false;
+	}
+	for ( i = 0; i < warmupTrials; ++i ) {
+		body ( repetitions );
+	}
+
+	allocationsBefore = heapAllocations;
+	for ( i = 0; i < trials; ++i ) {
+		nsPerOp[i] = ( double ) body ( repetitions ) / ( repetitions * opsPerRepetition );
+	}
+	result->allocationsPerOp = ( double ) ( heapAllocations - allocationsBefore ) / ( ( double ) trials * repetitions * opsPerRepetition );
+
+	qsort ( nsPerOp, trials, sizeof ( double ), compareDouble );
+	result->nsPerOpMedian = nsPerOp[trials / 2];
+	result->nsPerOpBest = nsPerOp[0];
+	return true;
+}
+
+// Prints one result, appends it to the CSV output and checks it against the baseline
+void reportResult ( BenchResult *result ) {
+	char processes[16], load[16], unsafe[16];
+	char line[512];
+	FILE *baselineFp;
+
+	if ( result->processes > 0 )
+		snprintf ( processes, sizeof ( processes ), "%d", result->processes );
+	else
+		strcpy ( processes, "-" );
+	if ( strcmp ( result->benchmark, "safety check" ) == 0 || strcmp ( result->benchmark, "safety blockers" ) == 0 ||
+	     strcmp ( result->benchmark, "calculateNeed" ) == 0 || strcmp ( result->benchmark, "resmgr" ) == 0 ) {
+		snprintf ( load, sizeof ( load ), "%d%%", result->loadPercent );
+		snprintf ( unsafe, sizeof ( unsafe ), "%d%%", result->unsafePercent );
+	} else {
+		strcpy ( load, "-" );
+		strcpy ( unsafe, "-" );
+	}
+
+	printf ( "%-16s %-14s %6s %5s %7s %14.1f %14.1f %14.0f %10.4f\n", result->benchmark, result->variant, processes, load, unsafe,
+		 result->nsPerOpMedian, result->nsPerOpBest, 1e9 / result->nsPerOpMedian, result->allocationsPerOp );
+	fflush ( stdout );
+
+	if ( csvFp != NULL )
+		fprintf ( csvFp, "%s,%s,%d,%d,%d,%.1f,%.1f,%.0f,%.4f\n", result->benchmark, result->variant, result->processes,
+			 result->loadPercent, result->unsafePercent, result->nsPerOpMedian, result->nsPerOpBest,
+			 1e9 / result->nsPerOpMedian, result->allocationsPerOp );
+
+	// Compare against the last matching row of the baseline
+	if ( baselineName == NULL )
+		return;
+	if ( ( baselineFp = fopen ( baselineName, "r" ) ) == NULL ) {
+		perror ( "BENCH: Failure to open the baseline." );
+		exit ( 1 );
+	}
+	double baselineNs = -1.0;
+	while ( fgets ( line, sizeof ( line ), baselineFp ) != NULL ) {
+		char benchmark[64], variant[64];
+		int rowProcesses, rowLoad, rowUnsafe;
+		double rowNs;
+
+		if ( sscanf ( line, "%63[^,],%63[^,],%d,%d,%d,%lf", benchmark, variant, &rowProcesses, &rowLoad, &rowUnsafe, &rowNs ) == 6 &&
+		     strcmp ( benchmark, result->benchmark ) == 0 && strcmp ( variant, result->variant ) == 0 &&
+		     rowProcesses == result->processes && rowLoad == result->loadPercent &&
+		     rowUnsafe == result->unsafePercent )
+			baselineNs = rowNs;
+	}
+	fclose ( baselineFp );
+
+	if ( baselineNs > 0 && result->nsPerOpMedian > baselineNs * ( 1.0 + regressionPercent / 100.0 ) ) {
+		fprintf ( stderr, "BENCH: Regression in %s (%s, %s processes, %s load): %.1f ns/op, baseline %.1f ns/op.\n",
+			 result->benchmark, result->variant, processes, load, result->nsPerOpMedian, baselineNs );
+		regressions++;
+	}
+}
+
+// One check of every state per repetition. Each state is checked repetitions times in a row, so
+//   the sparse masks only need rebuilding once per state, outside the clock.
+long long benchKernel ( long repetitions ) {
+	struct timespec start;
+	long long ns = 0;
+	long r;
+	int s;
+
+	for ( s = 0; s < stateCount; ++s ) {
+		BenchState *state = &states[s];
+		int safeAnswers = 0;
+
+		if ( benchedKernel == isSafeStateSparse )
+			sparseNeedRebuild ( state->maximum, state->allot, state->available );
+		clock_gettime ( CLOCK_MONOTONIC, &start );
+		for ( r = 0; r < repetitions; ++r ) {
+			safeAnswers += benchedKernel ( state->available, state->maximum, state->allot );
+		}
+		ns += elapsedNs ( &start );
+
+		if ( safeAnswers != ( state->safe ? repetitions : 0 ) )
+			mismatches++;
+
+		// The resources blamed for an unsafe answer must be the same whichever kernel gave it
+		if ( !state->safe && safeAnswers == 0 ) {
+			bool blockers[maxResources], expected[maxResources];
+
+			lastCheckBlockers ( state->maximum, state->allot, blockers );
+			findSafetyBlockers ( state->available, state->maximum, state->allot, expected );
+			if ( memcmp ( blockers, expected, sizeof ( expected ) ) != 0 )
+				mismatches++;
+		}
+	}
+	return ns;
+}
+
+// What the resource manager does after an unsafe answer: the blockers from where the check
+//   stopped. Each unsafe state is checked once outside the clock, then explained repetitions times.
+long long benchLastCheckBlockers ( long repetitions ) {
+	bool blockers[maxResources];
+	struct timespec start;
+	long long ns = 0;
+	long r;
+	int s;
+
+	for ( s = 0; s < stateCount; ++s ) {
+		if ( states[s].safe )
+			continue;
+		isSafeStateGeneric ( states[s].available, states[s].maximum, states[s].allot );
+		clock_gettime ( CLOCK_MONOTONIC, &start );
+		for ( r = 0; r < repetitions; ++r ) {
+			lastCheckBlockers ( states[s].maximum, states[s].allot, blockers );
+		}
+		ns += elapsedNs ( &start );
+	}
+	return ns;
+}
+
+// One blocker scan of every unsafe state per repetition
+long long benchBlockers ( long repetitions ) {
+	bool blockers[maxResources];
+	struct timespec start;
+	long r;
+	int s;
+
+	clock_gettime ( CLOCK_MONOTONIC, &start );
+	for ( r = 0; r < repetitions; ++r ) {
+		for ( s = 0; s < stateCount; ++s ) {
+			if ( !states[s].safe )
+				findSafetyBlockers ( states[s].available, states[s].maximum, states[s].allot, blockers );
+		}
+	}
+	return elapsedNs ( &start );
+}
+
+// One need matrix for every state per repetition
+long long benchCalculateNeed ( long repetitions ) {
+	struct timespec start;
+	long r;
+	int s;
+
+	clock_gettime ( CLOCK_MONOTONIC, &start );
+	for ( r = 0; r < repetitions; ++r ) {
+		for ( s = 0; s < stateCount; ++s ) {
+			calculateNeed ( need, states[s].maximum, states[s].allot );
+		}
+	}
+	return elapsedNs ( &start );
+}
+
+// One enqueue and one dequeue per repetition, with queueDepth items in the queue in between
+long long benchQueue ( long repetitions ) {
+	struct timespec start;
+	long r;
+
+	clock_gettime ( CLOCK_MONOTONIC, &start );
+	for ( r = 0; r < repetitions; ++r ) {
+		enqueue ( benchQueueHandle, r );
+		dequeue ( benchQueueHandle );
+	}
+	return elapsedNs ( &start );
+}
+
+// One increment of the simulated clock per repetition
+long long benchClock ( long repetitions ) {
+	unsigned int clock[2] = { 0, 0 };
+	struct timespec start;
+	long r;
+
+	clock_gettime ( CLOCK_MONOTONIC, &start );
+	for ( r = 0; r < repetitions; ++r ) {
+		incrementClock ( clock );
+	}
+	return elapsedNs ( &start );
+}
+
+long long benchClockCompare ( long repetitions ) {
+	unsigned int clock[2] = { 0, 0 };
+	struct timespec start;
+	long r;
+
+	clock_gettime ( CLOCK_MONOTONIC, &start );
+	for ( r = 0; r < repetitions; ++r ) {
+		incrementClockCompare ( clock );
+	}
+	return elapsedNs ( &start );
+}
+
+// One request granted and released per safe state with a request, per repetition. The manager is
+//   loaded with each state outside the clock.
+long long benchGrant ( long repetitions ) {
+	struct timespec start;
+	long long ns = 0;
+	long r;
+	int s;
+
+	for ( s = 0; s < stateCount; ++s ) {
+		BenchState *state = &states[s];
+		int granted = 0;
+
+		if ( !state->safe || state->requestProcess == -1 )
+			continue;
+		loadManager ( state );
+		requestVector[state->requestResource] = 1;
+		clock_gettime ( CLOCK_MONOTONIC, &start );
+		for ( r = 0; r < repetitions; ++r ) {
+			granted += resmgrRequest ( &benchManager, state->requestProcess, requestVector, r ) == resmgrGranted;
+			resmgrRelease ( &benchManager, state->requestProcess, requestVector, r );
+		}
+		ns += elapsedNs ( &start );
+		requestVector[state->requestResource] = 0;
+
+		if ( granted != repetitions )
+			mismatches++;
+	}
+	return ns;
+}
+
+// One retry of the blocked request per unsafe state with a request, per repetition. Each retry is
+//   denied and puts the request back in the queue, so the next one finds it again.
+long long benchRetry ( long repetitions ) {
+	struct timespec start;
+	long long ns = 0;
+	long r;
+	int s, process;
+
+	for ( s = 0; s < stateCount; ++s ) {
+		BenchState *state = &states[s];
+		int blocked = 0;
+
+		if ( state->safe || state->requestProcess == -1 )
+			continue;
+		loadManager ( state );
+		requestVector[state->requestResource] = 1;
+		if ( resmgrRequest ( &benchManager, state->requestProcess, requestVector, 0 ) != resmgrBlocked )
+			mismatches++;
+		requestVector[state->requestResource] = 0;
+		clock_gettime ( CLOCK_MONOTONIC, &start );
+		for ( r = 0; r < repetitions; ++r ) {
+			blocked += resmgrRetryBlocked ( &benchManager, r, &process ) == resmgrBlocked;
+		}
+		ns += elapsedNs ( &start );
+
+		if ( blocked != repetitions )
+			mismatches++;
+	}
+	return ns;
+}
+
+// Loads a state into benchManager as it stood before its request, with the kernel OSS would pick.
+// Processes with a claim are registered; the rest of the slots stay unused.
+void loadManager ( BenchState *state ) {
+	static const int emptyRow[maxResources];
+	int total[maxResources];
+	int i, j;
+
+	for ( j = 0; j < maxResources; ++j ) {
+		total[j] = state->available[j];
+		for ( i = 0; i < maxProcesses; ++i ) {
+			total[j] += state->allot[i][j];
+		}
+	}
+	resmgrReset ( &benchManager, total );
+	for ( i = 0; i < maxProcesses; ++i ) {
+		if ( memcmp ( state->maximum[i], emptyRow, sizeof ( emptyRow ) ) != 0 )
+			resmgrRegisterProcess ( &benchManager, i, state->maximum[i] );
+	}
+	memcpy ( benchManager.allot, state->allot, sizeof ( benchManager.allot ) );
+	memcpy ( benchManager.available, state->available, sizeof ( benchManager.available ) );
+	benchManager.allot[state->requestProcess][state->requestResource]--;
+	benchManager.available[state->requestResource]++;
+	resmgrSelectKernel ( &benchManager, "auto", largestClaim );
+}
+
+// Candidate replacement for incrementClock(): the clock is always normalized and the step is far
+//   below a second, so one comparison can stand in for the division and remainder.
+// The noinline keeps it a call, like incrementClock() from oss.c, so the two compare fairly.
+__attribute__ ( ( noinline ) ) void incrementClockCompare ( unsigned int clock[] ) {
+	clock[1] += 5000;
+	if ( clock[1] >= 1000000000 ) {
+		clock[0]++;
+		clock[1] -= 1000000000;
+	}
+}
+
+int compareDouble ( const void *a, const void *b ) {
+	double x = *( const double * ) a;
+	double y = *( const double * ) b;
+
+	return ( x > y ) - ( x < y );
+}
+
+// Nanoseconds since start
+long long elapsedNs ( struct timespec *start ) {
+	struct timespec now;
+
+	clock_gettime ( CLOCK_MONOTONIC, &now );
+	return ( now.tv_sec - start->tv_sec ) * 1000000000LL + ( now.tv_nsec - start->tv_nsec );
+}
+
+// Fills values from a comma separated list of integers
+void splitList ( int values[], int *count, char *flag, char *text ) {
+	char *end;
+
+	*count = 0;
+	while ( *text != '\0' && *count < maxListItems ) {
+		values[( *count )++] = strtol ( text, &end, 10 );
+		if ( end == text || ( *end != ',' && *end != '\0' ) ) {
+			fprintf ( stderr, "BENCH: %s takes a comma separated list of numbers.\n", flag );
+			exit ( 1 );
+		}
+		text = *end == ',' ? end + 1 : end;
+	}
+
+	if ( *count == 0 ) {
+		fprintf ( stderr, "BENCH: %s needs at least one value.\n", flag );
+		exit ( 1 );
+	}
+}
+
+// Prints the command line options
+void printUsage ( char *name ) {
+	printf ( "Usage: %s [options]\n", name );
+	printf ( "Times the banker's safety kernels, calculateNeed(), the blocked queue, incrementClock() and\n" );
+	printf ( "requests through the resource manager over generated states, for every combination of -p and -l.\n" );
+	printf ( "\t-p LIST\tLive processes in each state, at most %d (default 10,50,100)\n", maxProcesses );
+	printf ( "\t-l LIST\tLoad factors, percent of each resource allocated (default 25,50,90)\n" );
+	printf ( "\t-u PCT\tPercent of the states that are unsafe (default 50)\n" );
+	printf ( "\t-n N\tStates per configuration (default 64)\n" );
+	printf ( "\t-r N\tLargest total of each resource (default 10)\n" );
+	printf ( "\t-c N\tLargest claim on each resource (default 4)\n" );
+	printf ( "\t-t N\tTimed trials per benchmark (default 5)\n" );
+	printf ( "\t-w N\tWarmup trials per benchmark (default 1)\n" );
+	printf ( "\t-m MS\tShortest trial in milliseconds (default 10)\n" );
+	printf ( "\t-s SEED\tSeed for the generated states (default 1)\n" );
+	printf ( "\t-o FILE\tAppend the results to a CSV file\n" );
+	printf ( "\t-b FILE\tCompare against a CSV from -o; exit 1 on a regression\n" );
+	printf ( "\t-x PCT\tSlowdown over the baseline that counts as a regression (default 10)\n" );
+}
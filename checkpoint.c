@@ -0,0 +1,140 @@
+// File: checkpoint.c | Linked into: oss
+//
+// Checkpoints of OSS's resource manager state in a memory-mapped file.
+// A checkpoint is a copy of the state into the mapping followed by an asynchronous msync, so
+// the kernel writes it back while the main loop carries on.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "checkpoint.h"
+
+static CheckpointFile *checkpointMap = NULL;	// Mapping of the file OSS writes checkpoints to
+static unsigned long long lastSequence = 0;	// Sequence number of the last committed checkpoint
+static int writeSlot = 0;			// Slot the next checkpoint goes into
+
+// Maps the checkpoint file, creating it if needed. An existing file that matches this build keeps
+//   its contents, so restoring from and checkpointing to the same file works.
+bool openCheckpointFile ( const char *name ) {
+	int fd;
+
+	if ( ( fd = open ( name, O_RDWR | O_CREAT, 0666 ) ) == -1 ) {
+		perror ( "OSS: Failure to open the checkpoint file." );
+		return false;
+	}
+	if ( ftruncate ( fd, sizeof ( CheckpointFile ) ) == -1 ) {
+		perror ( "OSS: Failure to size the checkpoint file." );
+		close ( fd );
+		return false;
+	}
+
+	checkpointMap = mmap ( NULL, sizeof ( CheckpointFile ), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+	close ( fd );	// The mapping keeps the file open
+	if ( checkpointMap == MAP_FAILED ) {
+		perror ( "OSS: Failure to map the checkpoint file." );
+		checkpointMap = NULL;
+		return false;
+	}
+
+	// Carry on numbering from whatever is in the file, and write over the older slot first
+	if ( checkpointMap->magic == checkpointMagic && checkpointMap->version == checkpointVersion &&
+	     checkpointMap->stateSize == sizeof ( CheckpointState ) ) {
+		if ( checkpointMap->slot[0].sequenceEnd > lastSequence )
+			lastSequence = checkpointMap->slot[0].sequenceEnd;
+		if ( checkpointMap->slot[1].sequenceEnd > lastSequence ) {
+			lastSequence = checkpointMap->slot[1].sequenceEnd;
+			writeSlot = 0;
+		} else {
+			writeSlot = 1;
+		}
+	} else {
+		memset ( checkpointMap, 0, sizeof ( CheckpointFile ) );
+	}
+
+	checkpointMap->processSlots = maxProcesses;
+	checkpointMap->resourceTypes = maxResources;
+	checkpointMap->stateSize = sizeof ( CheckpointState );
+	checkpointMap->version = checkpointVersion;
+	checkpointMap->magic = checkpointMagic;
+
+	return true;
+}
+
+// Returns the slot to fill in for the next checkpoint. It is marked incomplete until commitCheckpoint().
+CheckpointState *beginCheckpoint () {
+	CheckpointState *state = &checkpointMap->slot[writeSlot];
+
+	state->sequenceStart = lastSequence + 1;
+	__sync_synchronize();
+	return state;
+}
+
+// Marks the slot from beginCheckpoint() complete and starts writing it back to the file
+void commitCheckpoint () {
+	CheckpointState *state = &checkpointMap->slot[writeSlot];
+
+	__sync_synchronize();
+	state->sequenceEnd = ++lastSequence;
+	writeSlot = 1 - writeSlot;
+
+	msync ( checkpointMap, sizeof ( CheckpointFile ), MS_ASYNC );
+}
+
+void closeCheckpointFile () {
+	if ( checkpointMap == NULL )
+		return;
+
+	msync ( checkpointMap, sizeof ( CheckpointFile ), MS_SYNC );
+	munmap ( checkpointMap, sizeof ( CheckpointFile ) );
+	checkpointMap = NULL;
+}
+
+// Copies the newest complete checkpoint in a file into state.
+// Fails if the file was written by an OSS built with different table sizes.
+bool loadCheckpoint ( const char *name, CheckpointState *state ) {
+	CheckpointFile *file;
+	CheckpointState *newest = NULL;
+	struct stat info;
+	int fd;
+	int i;
+
+	if ( ( fd = open ( name, O_RDONLY ) ) == -1 ) {
+		perror ( "OSS: Failure to open the checkpoint to restore." );
+		return false;
+	}
+	if ( fstat ( fd, &info ) == -1 || info.st_size != sizeof ( CheckpointFile ) ) {
+		fprintf ( stderr, "OSS: %s is not a checkpoint from this build of OSS.\n", name );
+		close ( fd );
+		return false;
+	}
+
+	file = mmap ( NULL, sizeof ( CheckpointFile ), PROT_READ, MAP_SHARED, fd, 0 );
+	close ( fd );
+	if ( file == MAP_FAILED ) {
+		perror ( "OSS: Failure to map the checkpoint to restore." );
+		return false;
+	}
+
+	if ( file->magic != checkpointMagic || file->version != checkpointVersion || file->stateSize != sizeof ( CheckpointState ) ||
+	     file->processSlots != maxProcesses || file->resourceTypes != maxResources ) {
+		fprintf ( stderr, "OSS: %s is not a checkpoint from this build of OSS.\n", name );
+		munmap ( file, sizeof ( CheckpointFile ) );
+		return false;
+	}
+
+	for ( i = 0; i < 2; ++i ) {
+		if ( file->slot[i].sequenceEnd != 0 && file->slot[i].sequenceStart == file->slot[i].sequenceEnd &&
+		     ( newest == NULL || file->slot[i].sequenceEnd > newest->sequenceEnd ) )
+			newest = &file->slot[i];
+	}
+	if ( newest == NULL ) {
+		fprintf ( stderr, "OSS: %s holds no complete checkpoint.\n", name );
+		munmap ( file, sizeof ( CheckpointFile ) );
+		return false;
+	}
+
+	memcpy ( state, newest, sizeof ( CheckpointState ) );
+	munmap ( file, sizeof ( CheckpointFile ) );
+	return true;
+}
@@ -0,0 +1,63 @@
+
+// File: checkpoint.h
+//
+// Header file for checkpoints of OSS's resource manager state (see checkpoint.c)
+
+#ifndef CHECKPOINT_HEADER_FILE
+#define CHECKPOINT_HEADER_FILE
+
+#include <stdbool.h>
+
+#include "oss.h"
+
+#define checkpointMagic 0x4F53534B	// "OSSK"
+#define checkpointVersion 3		// Bump whenever CheckpointState changes
+
+// Everything OSS needs to pick a run back up, mostly copied out of its ResourceManager (see resmgr.h).
+// Filled in by oss.c between two passes of its main loop, so the tables, the blocked queue and the
+//   statistics always agree with each other.
+typedef struct {
+	unsigned long long sequenceStart;	// Written before the state...
+	unsigned int clock[2];			// Simulated clock
+	unsigned int seed;			// Run seed
+	int totalResources[maxResources];
+	int available[maxResources];
+	int maximum[maxProcesses][maxResources];
+	int allot[maxProcesses][maxResources];
+	int requested[maxProcesses][maxResources];	// Last request of each process (outstanding if it is in the blocked queue)
+	long long requestTime[maxProcesses];	// When each of them reached OSS, in simulated ns
+	int live[maxProcesses];			// 1 if a USER was running in the slot
+	int userClass[maxProcesses];		// Workload class of each USER
+	int blockedQueue[maxProcesses];		// Blocked queue, front first
+	int blockedCount;
+
+	// Statistics
+	int totalResourcesRequested;
+	int totalRequestsGranted;
+	int totalSafeStateChecks;
+	int totalResourcesReleased;
+	int totalProcessesCreated;
+	int totalProcessesTerminated;
+	int totalMessagesProcessed;
+	unsigned long long sequenceEnd;		// ...and again after it. A slot is whole when both match.
+} CheckpointState;
+
+// Layout of the checkpoint file. Checkpoints alternate between the two slots, so the last complete
+//   one survives if OSS dies in the middle of writing the next.
+typedef struct {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int processSlots;	// maxProcesses as built into OSS
+	unsigned int resourceTypes;	// maxResources as built into OSS
+	unsigned int stateSize;		// sizeof ( CheckpointState )
+	CheckpointState slot[2];
+} CheckpointFile;
+
+/* Function Prototypes */
+bool openCheckpointFile ( const char *name );
+CheckpointState *beginCheckpoint ();
+void commitCheckpoint ();
+void closeCheckpointFile ();
+bool loadCheckpoint ( const char *name, CheckpointState *state );
+
+#endif
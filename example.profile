@@ -0,0 +1,7 @@
+# Example workload profile for OSS -W (format described at the top of workload.c).
+# Most clients are interactive: short holds, a few hot resources. A minority are batch
+# jobs that grab resources in bursts and sit on them.
+
+class interactive weight=7 actions=45:45:10 zipf=1.2 hold=200000 think=50000
+class batch weight=2 actions=70:25:5 zipf=0.5 burst=30:6 hold=5000000
+class scanner weight=1 actions=50:45:5 think=500000
@@ -0,0 +1,336 @@
+// File: logstream.c | Linked into: oss, rebuild
+//
+// OSS's logfile as a stream. OSS writes to it with fprintf like any other FILE (it is a
+// fopencookie stream), but the bytes are collected in large blocks and written out by a
+// background thread, so the main loop never waits on the disk or on compression unless
+// every block is full.
+// The log can be split into numbered segments of a set size (prog.log.0000, prog.log.0001, ...),
+// keeping only the newest few, and each file can be gzip compressed as it is written.
+// Segments always end at the end of a line.
+
+#define _GNU_SOURCE	// fopencookie
+#include <fcntl.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <zlib.h>
+
+#include "logstream.h"
+#include "trace.h"
+
+// A block of log text on its way to the writer
+typedef struct {
+	char data[logBlockSize];
+	size_t length;
+	bool endsSegment;	// The writer starts the next segment after this block
+	bool last;		// The stream is closing; the writer stops after this block
+} LogBlock;
+
+// Blocks go round in a ring: OSS fills them in order and the writer drains them in the same order.
+// Only the two semaphores are shared, so neither side ever holds a lock the other (or a signal
+//   handler on the main thread) could be waiting on.
+static LogBlock blocks[logBlockCount];
+static sem_t freeBlocks;	// Blocks OSS may fill
+static sem_t filledBlocks;	// Blocks waiting for the writer
+static LogBlock *current = NULL;	// Block OSS is filling, NULL if it holds none
+static int fillIndex = 0;	// Next block OSS fills
+static pthread_t writerThread;
+static bool writerRunning = false;
+
+// Settings from openLogStream()
+static char logName[PATH_MAX];
+static long long segmentLimit;	// Bytes of text per segment, 0 for a single file
+static int segmentsKept;	// Newest segments kept on disk, 0 for all
+static int gzipLevel;		// 0 for plain files
+
+// Kept by OSS's side of the stream
+static long long segmentBytes = 0;	// Text in the current segment so far
+static long long linesWritten = 0;
+static long long bytesWritten = 0;
+static bool segmentStarted = false;	// Set when a segment ends, cleared by logSegmentStarted()
+
+// Kept by the writer (and by openLogStream() before the writer starts)
+static int segmentNumber = 0;
+static int segmentFd = -1;
+static gzFile segmentGz = NULL;
+static bool writerFailed = false;	// Once a write fails the rest of the log is dropped
+
+// Sampling of routine events (see setLogSampling())
+static LogLevel logLevel = logLevelFull;
+static int samplePercent = 100;
+static unsigned int sampleState = 1;
+
+static bool openSegment ();
+static void closeSegment ();
+static void *logWriter ( void *unused );
+static ssize_t logStreamWrite ( void *cookie, const char *data, size_t size );
+static int logStreamClose ( void *cookie );
+static LogBlock *takeBlock ();
+static void handOff ();
+
+// Opens the log for writing and starts the background writer. segmentBytes of 0 writes one file
+//   called name; otherwise the log is split into name.0000, name.0001, ... of about segmentBytes each,
+//   and only the newest keepSegments are kept (all of them if 0). A compressionLevel of 1-9 gzips
+//   every file (adding .gz to the name). Returns NULL, after printing why, if the log can't be opened.
+FILE *openLogStream ( const char *name, long long segmentBytes, int keepSegments, int compressionLevel ) {
+	cookie_io_functions_t functions = { NULL, logStreamWrite, NULL, logStreamClose };
+	sigset_t allSignals, previousSignals;
+	FILE *stream;
+	int error;
+
+	snprintf ( logName, sizeof ( logName ), "%s", name );
+	segmentLimit = segmentBytes;
+	segmentsKept = keepSegments;
+	gzipLevel = compressionLevel;
+
+	// The first file is opened here, so a bad name fails the run at startup
+	if ( !openSegment() )
+		return NULL;
+
+	sem_init ( &freeBlocks, 0, logBlockCount );
+	sem_init ( &filledBlocks, 0, 0 );
+
+	// The writer takes no signals. OSS's handlers expect to run on the main thread.
+	sigfillset ( &allSignals );
+	pthread_sigmask ( SIG_SETMASK, &allSignals, &previousSignals );
+	error = pthread_create ( &writerThread, NULL, logWriter, NULL );
+	pthread_sigmask ( SIG_SETMASK, &previousSignals, NULL );
+	if ( error != 0 ) {
+		errno = error;
+		perror ( "OSS: Failure to start the log writer." );
+		closeSegment();
+		return NULL;
+	}
+	writerRunning = true;
+
+	if ( ( stream = fopencookie ( NULL, "w", functions ) ) == NULL ) {
+		perror ( "OSS: Failure to open the logfile stream." );
+		return NULL;
+	}
+
+	// Unbuffered, so each fprintf goes straight into a block: the line count is always exact and
+	//   there is no second copy of the text sitting in a stdio buffer
+	setvbuf ( stream, NULL, _IONBF, 0 );
+	return stream;
+}
+
+// Hands whatever has been written so far to the writer, without waiting for it to reach the disk
+void flushLogStream () {
+	if ( current != NULL && current->length > 0 )
+		handOff();
+}
+
+// Picks how much routine traffic is logged. At logLevelSampled each routine event is kept with a
+//   chance of percent in 100, drawn from its own generator so sampling doesn't change the run.
+void setLogSampling ( LogLevel level, int percent, unsigned int seed ) {
+	logLevel = level;
+	samplePercent = percent;
+	sampleState = seed | 1;	// xorshift never leaves 0
+}
+
+// True if a routine event should be logged
+bool logRoutineEvent () {
+	if ( logLevel == logLevelFull )
+		return true;
+
+	sampleState ^= sampleState << 13;
+	sampleState ^= sampleState >> 17;
+	sampleState ^= sampleState << 5;
+	return sampleState % 100 < ( unsigned int ) samplePercent;
+}
+
+// True once after each segment ends, so OSS can start the next one with whatever it needs to
+//   stand on its own (see writeAllocationSnapshot() in oss.c)
+bool logSegmentStarted () {
+	if ( !segmentStarted )
+		return false;
+
+	segmentStarted = false;
+	return true;
+}
+
+// Lines and bytes of text written to the log so far, before compression
+long long logStreamLines () {
+	return linesWritten;
+}
+
+long long logStreamBytes () {
+	return bytesWritten;
+}
+
+// CPU time the background writer has used so far (writing and compressing), in nanoseconds,
+//   or -1 once it has stopped
+long long logWriterCpuNs () {
+	struct timespec used;
+	clockid_t clock;
+
+	if ( !writerRunning || pthread_getcpuclockid ( writerThread, &clock ) != 0 || clock_gettime ( clock, &used ) == -1 )
+		return -1;
+	return used.tv_sec * 1000000000LL + used.tv_nsec;
+}
+
+// Name of one file of the log. Shared with rebuild, which reads them back.
+void logSegmentName ( char *buffer, size_t size, const char *name, int segment, bool segmented, bool compressed ) {
+	if ( segmented )
+		snprintf ( buffer, size, "%s.%0*d%s", name, logSegmentDigits, segment, compressed ? ".gz" : "" );
+	else
+		snprintf ( buffer, size, "%s%s", name, compressed ? ".gz" : "" );
+}
+
+// Opens the file for segmentNumber and removes the one that falls out of the kept window
+static bool openSegment () {
+	char name[PATH_MAX + 16];
+	char mode[16];
+
+	logSegmentName ( name, sizeof ( name ), logName, segmentNumber, segmentLimit > 0, gzipLevel > 0 );
+	if ( ( segmentFd = open ( name, O_WRONLY | O_CREAT | O_TRUNC, 0666 ) ) == -1 ) {
+		perror ( "OSS: Failure to open the logfile." );
+		return false;
+	}
+	if ( gzipLevel > 0 ) {
+		snprintf ( mode, sizeof ( mode ), "wb%d", gzipLevel );
+		if ( ( segmentGz = gzdopen ( segmentFd, mode ) ) == NULL ) {
+			fprintf ( stderr, "OSS: Failure to start compressing %s.\n", name );
+			close ( segmentFd );
+			return false;
+		}
+	}
+
+	if ( segmentLimit > 0 && segmentsKept > 0 && segmentNumber >= segmentsKept ) {
+		logSegmentName ( name, sizeof ( name ), logName, segmentNumber - segmentsKept, true, gzipLevel > 0 );
+		unlink ( name );
+	}
+	return true;
+}
+
+static void closeSegment () {
+	if ( segmentGz != NULL ) {
+		gzclose ( segmentGz );	// Closes segmentFd too
+		segmentGz = NULL;
+	} else if ( segmentFd != -1 ) {
+		close ( segmentFd );
+	}
+	segmentFd = -1;
+}
+
+// Background writer: drains filled blocks into the current segment, moving to the next segment
+//   where a block says so, until the closing block comes through
+static void *logWriter ( void *unused ) {
+	int drainIndex = 0;
+	bool last = false;
+
+	while ( !last ) {
+		LogBlock *block;
+		size_t written = 0;
+		ssize_t result;
+
+		while ( sem_wait ( &filledBlocks ) == -1 && errno == EINTR );
+		block = &blocks[drainIndex];
+		drainIndex = ( drainIndex + 1 ) % logBlockCount;
+
+		if ( !writerFailed && block->length > 0 ) {
+			if ( segmentGz != NULL ) {
+				if ( gzwrite ( segmentGz, block->data, block->length ) == 0 ) {
+					fprintf ( stderr, "OSS: Failure to write the compressed logfile; the rest of the log is dropped.\n" );
+					writerFailed = true;
+				}
+			} else {
+				while ( written < block->length ) {
+					if ( ( result = write ( segmentFd, block->data + written, block->length - written ) ) == -1 ) {
+						if ( errno == EINTR )
+							continue;
+						perror ( "OSS: Failure to write the logfile; the rest of the log is dropped." );
+						writerFailed = true;
+						break;
+					}
+					written += result;
+				}
+			}
+		}
+		if ( !writerFailed && block->endsSegment ) {
+			closeSegment();
+			segmentNumber++;
+			writerFailed = !openSegment();
+		}
+
+		last = block->last;
+		sem_post ( &freeBlocks );
+	}
+
+	closeSegment();
+	return NULL;
+}
+
+// Write function of the stream. Copies the text into blocks, handing each one off when it is full
+//   or when the text in the segment reaches segmentLimit and a line ends.
+static ssize_t logStreamWrite ( void *cookie, const char *data, size_t size ) {
+	size_t done = 0;
+
+	while ( done < size ) {
+		LogBlock *block = takeBlock();
+		size_t chunk = size - done;
+		bool endsSegment = false;
+		const char *newline;
+
+		if ( chunk > logBlockSize - block->length )
+			chunk = logBlockSize - block->length;
+
+		// Once the segment is full, it ends with the next newline
+		if ( segmentLimit > 0 && segmentBytes + ( long long ) chunk >= segmentLimit ) {
+			size_t from = segmentBytes >= segmentLimit - 1 ? 0 : segmentLimit - 1 - segmentBytes;
+
+			if ( ( newline = memchr ( data + done + from, '\n', chunk - from ) ) != NULL ) {
+				chunk = newline - ( data + done ) + 1;
+				endsSegment = true;
+			}
+		}
+
+		memcpy ( block->data + block->length, data + done, chunk );
+		for ( newline = data + done; ( newline = memchr ( newline, '\n', data + done + chunk - newline ) ) != NULL; ++newline ) {
+			linesWritten++;
+		}
+		block->length += chunk;
+		segmentBytes += chunk;
+		bytesWritten += chunk;
+		done += chunk;
+
+		if ( endsSegment ) {
+			block->endsSegment = true;
+			segmentBytes = 0;
+			segmentStarted = true;
+			handOff();
+		} else if ( block->length == logBlockSize ) {
+			handOff();
+		}
+	}
+
+	return size;
+}
+
+// Close function of the stream: sends the closing block and waits for the writer to finish
+static int logStreamClose ( void *cookie ) {
+	takeBlock()->last = true;
+	handOff();
+	pthread_join ( writerThread, NULL );
+	writerRunning = false;
+	return writerFailed ? -1 : 0;
+}
+
+// Block OSS is filling, waiting for the writer to free one if they are all full
+static LogBlock *takeBlock () {
+	if ( current == NULL ) {
+		while ( sem_wait ( &freeBlocks ) == -1 && errno == EINTR );
+		current = &blocks[fillIndex];
+		current->length = 0;
+		current->endsSegment = false;
+		current->last = false;
+	}
+	return current;
+}
+
+// Passes the block being filled to the writer
+static void handOff () {
+	OSS_TRACE ( log_flush, current->length, bytesWritten, linesWritten, current->endsSegment );
+	current = NULL;
+	fillIndex = ( fillIndex + 1 ) % logBlockCount;
+	sem_post ( &filledBlocks );
+}
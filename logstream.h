@@ -0,0 +1,34 @@
+
+// File: logstream.h
+//
+// Header file for OSS's logfile stream (see logstream.c)
+
+#ifndef LOGSTREAM_HEADER_FILE
+#define LOGSTREAM_HEADER_FILE
+
+#include <stdbool.h>
+
+#include "oss.h"
+
+#define logBlockSize ( 64 * 1024 )	// Bytes handed to the background writer at a time
+#define logBlockCount 8			// Blocks in flight; OSS only waits on the writer once all are full
+#define logSegmentDigits 4		// Least digits of the segment numbers in file names, e.g. prog.log.0007.gz
+
+// How much of the routine traffic (requests, grants, releases, retries that stay blocked) is logged
+typedef enum {
+	logLevelFull,		// Everything
+	logLevelSampled		// A fraction of it; blocks, unblocks, process lifecycle and snapshots are always kept
+} LogLevel;
+
+/* Function Prototypes */
+FILE *openLogStream ( const char *name, long long segmentBytes, int keepSegments, int compressionLevel );
+void flushLogStream ();
+void setLogSampling ( LogLevel level, int percent, unsigned int seed );
+bool logRoutineEvent ();
+bool logSegmentStarted ();
+long long logStreamLines ();
+long long logStreamBytes ();
+long long logWriterCpuNs ();
+void logSegmentName ( char *buffer, size_t size, const char *name, int segment, bool segmented, bool compressed );
+
+#endif
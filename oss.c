@@ -4,67 +4,334 @@
 // Master process to simulate a resource management module
 
 #include "oss.h"
+#include "resmgr.h"
+#include "checkpoint.h"
+#include "workload.h"
+#include "allocations.h"
+#include "simclock.h"
+#include "logstream.h"
+#include "profile.h"
+#include "trace.h"
+
+// Writes to the logfile from the main loop, timed as log I/O in the profile (see profile.c).
+// Nothing more is written once the log has reached its line limit (see logFull()).
+#define logLine( ... ) do { if ( !logFull() ) { profileEnter ( phaseLog ); fprintf ( fp, __VA_ARGS__ ); profileLeave(); } } while ( 0 )
+
+/* Message Queue Variables */
+Message message;	// Last message received; handled in place
+Message reply;		// Messages OSS sends (grants, and terminations queued on behalf of dead USERs)
+int messageID;
+key_t messageKey;
+
+/* Shared Memory Variables */
+int shmRegionID;
+SharedRegion *shmRegion;
+key_t shmRegionKey;
+unsigned int *shmClock;
 
-// Queue code is gotten from https://www.geeksforgeeks.org/queue-set-1introduction-and-array-implementation/
-// A structure to represent a queue
-typedef struct {
-	int front, rear, size;
-	unsigned capacity;
-	int *array;  
-	int pid;
-} Queue;
-                   
-// Queue Protypte Functions
-Queue* createQueue ( unsigned capacity );
-int isFull ( Queue* queue ); 
-int isEmpty ( Queue* queue );
-void enqueue ( Queue* queue, int item );
-int dequeue ( Queue* queue );
-int front ( Queue* queue );
-int rear ( Queue* queue );
 
 // Other Prototype Functions
-void calculateNeed ( int need[maxProcesses][maxResources], int maximum[maxProcesses][maxResources], int allot[maxProcesses][maxResources] );
-bool isSafeState ( int available[], int maximum[][maxResources], int allot[][maxResources] );
-void incrementClock ( unsigned int shmClock[] );
+ResmgrResult requestResource ( int processIndex, int resource );
+void checkVerifiedSafety ( int processIndex, int resource );
 void printAllocatedResourcesTable( int num1, int array[][maxResources] );
 void printMaxClaimTable( int num1, int array[][maxResources] );
 void printReport();
+void printHotResources ( FILE *out );
+int compareHotResources ( const void *a, const void *b );
+long long simulatedTime ();
+void writeAllocationSnapshot ( int allot[][maxResources], bool allRows );
+void writeResultRow();
+void recordLatency ( long long requestTime, long long grantTime );
+int compareLatency ( const void *a, const void *b );
+void printUsage ( char *name );
+void saveCheckpoint ();
+void restoreCheckpoint ( CheckpointState *state );
+pid_t spawnUser ( int processIndex, int instance, int claims[], int allocation[], int pendingRequest );
+const char *runLimitReached ( long long logLines );
+bool logFull ();
+void reapUsers();
+bool isStaleObject ( struct ipc_perm *perm, pid_t creatorPid );
+bool processGone ( pid_t pid );
+bool regionAttached ( key_t key );
+void removeStaleIPC();
+void resetProcessControl ( ProcessControl *control );
 void terminateIPC();
 
+// Resource tables, blocked queue and banker's decisions (see resmgr.c). OSS feeds it the USERs'
+//   messages; it also keeps the request, grant, safety check and release counts and the
+//   per-resource contention statistics (reported sorted by printHotResources()).
+ResourceManager manager;
+
 // Variables to keep statistics over the course of the program run
-int totalResourcesRequested;
-int totalRequestsGranted;
-int totalSafeStateChecks;
-int totalResourcesReleased;
 int totalProcessesCreated;
 int totalProcessesTerminated;
+int totalMessagesProcessed;	// Messages from USER that OSS has handled (requests, releases and terminations)
+struct timespec runStartTime;	// Real time at which OSS started, for throughput
+
+// Allocation table snapshots (format in oss.h). The manager marks the rows it touches in
+//   manager.dirtyRows; a snapshot writes the marked rows that really differ from what the last one wrote.
+int snapshotInterval = 20;	// Messages processed between snapshots
+int nextSnapshot;	// totalMessagesProcessed at which the next snapshot is due
+int snapshotTable[maxProcesses][maxResources];	// Allocated table as of the last snapshot (starts all zero)
 
-const int maxRunningProcesses = 18;	// Controls how many processes are allow to be alive at any given time
-const int totalProcessLimit = 100;	// Controls how many processes are allowed to be created over the life of the program
-const int maxAmountOfEachResource = 4;	// Bound to control the max claim for each resource by USER
+unsigned long loopStartAllocations;	// heapAllocations when the main loop started
+volatile sig_atomic_t statsRequested = 0;	// Set by SIGUSR1; the main loop prints the live statistics
+
+// Simulated time from each request arriving at OSS to it being granted, in nanoseconds.
+// Samples past the end of the array are counted but not stored.
+#define maxLatencySamples 100000
+long long latencySamples[maxLatencySamples];
+int totalLatencySamples;
+
+// Tuning knobs. Defaults match the original constants and can be changed with command line options (see printUsage()).
+int maxRunningProcesses = 18;	// Controls how many processes are allow to be alive at any given time
+const int totalProcessLimit = maxProcesses;	// Controls how many processes are allowed to be created over the life of the program
+int maxAmountOfEachResource = 4;	// Bound to control the max claim for each resource by USER
+unsigned int nextProcessTimeBound = 5000;	// Used as a bound when generating the random time for the next process to be created
+int resourceTotalLower = 1;	// Bounds for the random total of each resource in the system
+int resourceTotalUpper = 10;
+int requestPercent = 45;	// Chance that USER requests, releases or terminates on each action. Passed to USER.
+int releasePercent = 45;
+int terminatePercent = 10;
+unsigned int runSeed;	// Seed for OSS and, combined with the process index, for each USER
+int killTimer = 2;	// Value to control how many real-life seconds program can run for (0 for no limit)
+int drainTimer = 5;	// Real-life seconds the drain phase may take before the remaining USERs are killed
+
+// Run limits. When one is reached OSS stops spawning, lets the live USERs finish, then reports.
+// A limit of 0 is disabled. Limits on work done make runs comparable across machines, unlike killTimer.
+unsigned int simTimeLimit[2] = { 0, 0 };	// Simulated time
+int eventLimit = 0;	// Messages processed
+int completedLimit = 0;	// Processes that have terminated
+int logLineLimit = 10000;	// Lines written to the logfile (per project instruction)
+bool logLineLimitGiven = false;	// -L was given; otherwise a segmented log has no line limit
+volatile sig_atomic_t stopRequested = 0;	// Set by the killTimer alarm to start the drain phase
+volatile sig_atomic_t draining = 0;	// Set once the drain phase has started
+char *resultFile = NULL;	// If set, one CSV row of run statistics is appended here on exit
+char *kernelChoice = "auto";	// Banker's safety check to use: auto, sparse, queued, dense or generic
+bool verifySafety = false;	// Check every safety decision against the generic check
+bool profiling = true;	// Time profile of OSS's loop and the USERs' request path (see profile.c)
 FILE *fp;	// Used for opening and writing to filename described below
 
+// Logfile stream (see logstream.c). By default the log is one plain file with every event in it.
+long long logSegmentBytes = 0;	// -g: split the log into segments of this size, 0 for one file
+int logSegmentsKept = 0;	// Newest segments kept on disk, 0 for all
+int logCompression = 0;		// -z: gzip level for the log files, 0 for plain text
+LogLevel logDetail = logLevelFull;	// -v: full, or sampled routine events
+int logSamplePercent = 10;	// Percent of routine events kept at the sampled level
+pid_t userPids[maxProcesses];	// PID of the USER at each process index, so shutdown only signals this instance's children
+
+// Checkpoints (see checkpoint.c). OSS copies its state to checkpointName every checkpointInterval
+//   messages and when a run limit is reached. A run started with -R picks up from restoreName.
+char *checkpointName = NULL;
+int checkpointInterval = 1000;
+int nextCheckpoint;	// totalMessagesProcessed at which the next checkpoint is due
+char *restoreName = NULL;
+CheckpointState restoredState;	// Too large for the stack when maxProcesses is raised
+
+// Workload profile (-W, see workload.c). Without one every USER is in a single class built from -w.
+char *workloadName = "none";
+WorkloadClass workloadClasses[maxWorkloadClasses];
+int workloadClassCount = 1;
+int userClass[maxProcesses];	// Class of the USER at each process index
+int requestVector[maxResources];	// USERs ask for one unit at a time; this is the vector handed to the manager
+
 /*************************************************************************************************************/
 /******************************************* Start of Main Function ******************************************/
 /*************************************************************************************************************/
 
 int main ( int argc, char *argv[] ) {
 	
-	int i, j;	// Index variables to use in loops
-	srand ( time ( NULL ) );	// Seed for OSS to generate random numbers when necessary
+	int i;	// Index variable to use in loops
 	unsigned int newProcessTime[2] = { 0, 0 };	// Initial value for time at which a new process shoudld be created
 	totalProcessesCreated = 0;	// Tracks the number of processes that have been created
 	int myPid = getpid();
+	char *logName = "prog.log";	// Name of logfile that will be written to through the program
+	int option;
+	bool seedGiven = false;	// A restored run keeps the checkpoint's seed unless -s is given
+	int segmentMegabytes;
+	
+	/* Command line options */
+	runSeed = time ( NULL );
+	double simSeconds;
+	while ( ( option = getopt ( argc, argv, "hp:m:n:r:w:s:t:l:o:T:e:c:L:d:k:VPC:i:R:W:a:g:z:v:" ) ) != -1 ) {
+		switch ( option ) {
+			case 'h':
+				printUsage ( argv[0] );
+				return 0;
+			case 'p':
+				maxRunningProcesses = atoi ( optarg );
+				break;
+			case 'm':
+				maxAmountOfEachResource = atoi ( optarg );
+				break;
+			case 'n':
+				nextProcessTimeBound = atoi ( optarg );
+				break;
+			case 'r':
+				if ( sscanf ( optarg, "%d:%d", &resourceTotalLower, &resourceTotalUpper ) != 2 ) {
+					fprintf ( stderr, "OSS: -r expects LOW:HIGH.\n" );
+					return 1;
+				}
+				break;
+			case 'w':
+				if ( sscanf ( optarg, "%d:%d:%d", &requestPercent, &releasePercent, &terminatePercent ) != 3 ) {
+					fprintf ( stderr, "OSS: -w expects REQUEST:RELEASE:TERMINATE.\n" );
+					return 1;
+				}
+				break;
+			case 's':
+				runSeed = strtoul ( optarg, NULL, 10 );
+				seedGiven = true;
+				break;
+			case 't':
+				killTimer = atoi ( optarg );
+				break;
+			case 'l':
+				logName = optarg;
+				break;
+			case 'o':
+				resultFile = optarg;
+				break;
+			case 'T':
+				simSeconds = atof ( optarg );
+				simTimeLimit[0] = ( unsigned int ) simSeconds;
+				simTimeLimit[1] = ( unsigned int ) ( ( simSeconds - simTimeLimit[0] ) * 1000000000 );
+				break;
+			case 'e':
+				eventLimit = atoi ( optarg );
+				break;
+			case 'c':
+				completedLimit = atoi ( optarg );
+				break;
+			case 'L':
+				logLineLimit = atoi ( optarg );
+				logLineLimitGiven = true;
+				break;
+			case 'd':
+				drainTimer = atoi ( optarg );
+				break;
+			case 'k':
+				kernelChoice = optarg;
+				break;
+			case 'V':
+				verifySafety = true;
+				break;
+			case 'P':
+				profiling = false;
+				profileDisable();
+				break;
+			case 'C':
+				checkpointName = optarg;
+				break;
+			case 'i':
+				checkpointInterval = atoi ( optarg );
+				break;
+			case 'R':
+				restoreName = optarg;
+				break;
+			case 'W':
+				workloadName = optarg;
+				break;
+			case 'a':
+				snapshotInterval = atoi ( optarg );
+				break;
+			case 'g':
+				if ( sscanf ( optarg, "%d:%d", &segmentMegabytes, &logSegmentsKept ) < 1 || segmentMegabytes < 1 || logSegmentsKept < 0 ) {
+					fprintf ( stderr, "OSS: -g expects MB[:KEEP] with MB at least 1.\n" );
+					return 1;
+				}
+				logSegmentBytes = segmentMegabytes * 1024LL * 1024LL;
+				break;
+			case 'z':
+				logCompression = atoi ( optarg );
+				break;
+			case 'v':
+				if ( strcmp ( optarg, "full" ) == 0 ) {
+					logDetail = logLevelFull;
+				} else if ( strncmp ( optarg, "sampled", 7 ) == 0 && 
+					    ( optarg[7] == '\0' || sscanf ( optarg + 7, ":%d", &logSamplePercent ) == 1 ) ) {
+					logDetail = logLevelSampled;
+				} else {
+					fprintf ( stderr, "OSS: -v must be full or sampled[:PERCENT].\n" );
+					return 1;
+				}
+				break;
+			default:
+				printUsage ( argv[0] );
+				return 1;
+		}
+	}
+	
+	if ( maxRunningProcesses < 1 || maxRunningProcesses > totalProcessLimit ) {
+		fprintf ( stderr, "OSS: -p must be between 1 and %d.\n", totalProcessLimit );
+		return 1;
+	}
+	if ( maxAmountOfEachResource < 1 || nextProcessTimeBound < 1 || drainTimer < 1 || checkpointInterval < 1 || snapshotInterval < 1 ) {
+		fprintf ( stderr, "OSS: -m, -n, -d, -i and -a must be at least 1.\n" );
+		return 1;
+	}
+	if ( strcmp ( kernelChoice, "auto" ) != 0 && strcmp ( kernelChoice, "sparse" ) != 0 && 
+	     strcmp ( kernelChoice, "queued" ) != 0 && strcmp ( kernelChoice, "dense" ) != 0 && 
+	     strcmp ( kernelChoice, "generic" ) != 0 ) {
+		fprintf ( stderr, "OSS: -k must be auto, sparse, queued, dense or generic.\n" );
+		return 1;
+	}
+	if ( killTimer < 0 || eventLimit < 0 || completedLimit < 0 || logLineLimit < 0 ) {
+		fprintf ( stderr, "OSS: -t, -e, -c and -L can't be negative.\n" );
+		return 1;
+	}
+	if ( resourceTotalLower < 1 || resourceTotalUpper < resourceTotalLower ) {
+		fprintf ( stderr, "OSS: -r needs 1 <= LOW <= HIGH.\n" );
+		return 1;
+	}
+	if ( requestPercent < 0 || releasePercent < 0 || terminatePercent < 0 || 
+	     requestPercent + releasePercent + terminatePercent != 100 ) {
+		fprintf ( stderr, "OSS: -w percentages must be non-negative and add up to 100.\n" );
+		return 1;
+	}
+	if ( logCompression < 0 || logCompression > 9 || logSamplePercent < 0 || logSamplePercent > 100 ) {
+		fprintf ( stderr, "OSS: -z must be 0-9 and the -v sampled percentage 0-100.\n" );
+		return 1;
+	}
+	
+	// Segments already bound the disk the log takes, so the line limit only applies if asked for
+	if ( logSegmentBytes > 0 && !logLineLimitGiven )
+		logLineLimit = 0;
+	
+	// Client classes. A single default class keeps runs without a profile exactly as they were.
+	if ( strcmp ( workloadName, "none" ) != 0 ) {
+		if ( ( workloadClassCount = loadWorkloadProfile ( workloadName, workloadClasses ) ) == -1 )
+			return 1;
+	} else {
+		memset ( &workloadClasses[0], 0, sizeof ( WorkloadClass ) );
+		strcpy ( workloadClasses[0].name, "default" );
+		workloadClasses[0].weight = 1;
+		workloadClasses[0].requestPercent = requestPercent;
+		workloadClasses[0].releasePercent = releasePercent;
+		workloadClasses[0].terminatePercent = terminatePercent;
+	}
+	
+	// Load the checkpoint to restore before anything is set up, so a bad file fails the run early
+	if ( restoreName != NULL ) {
+		if ( !loadCheckpoint ( restoreName, &restoredState ) )
+			return 1;
+		if ( !seedGiven )
+			runSeed = restoredState.seed;
+	}
+	
+	// A restored run carries on from part way through the original, so its random numbers do too
+	srand ( runSeed + ( restoreName != NULL ? restoredState.totalMessagesProcessed : 0 ) );	// Seed for OSS to generate random numbers when necessary
+	clock_gettime ( CLOCK_MONOTONIC, &runStartTime );
 	
 	/* Output file info */
-	int numberOfLines = 0;	// Tracks the number of lines being written to the file
-	char logName[10] = "prog.log";	// Name of logfile that will be written to through the program
-	fp = fopen ( logName, "w+" );	// Opens file for writing
+	// Written through the background writer in logstream.c, which also counts the lines
+	if ( ( fp = openLogStream ( logName, logSegmentBytes, logSegmentsKept, logCompression ) ) == NULL )
+		return 1;
+	setLogSampling ( logDetail, logSamplePercent, runSeed );
 	
 	/* Signal handling */ 
-	const int killTimer = 2;	// Value to control how many real-life seconds program can run for
-	alarm ( killTimer );	// Sets the timer alarm based on value of killTimer
+	if ( killTimer > 0 )
+		alarm ( killTimer );	// Sets the timer alarm based on value of killTimer
 
 	if ( signal ( SIGINT, handle ) == SIG_ERR ) {
 		perror ( "OSS: ctrl-c signal failed." );
@@ -74,128 +341,171 @@ int main ( int argc, char *argv[] ) {
 		perror ( "OSS: alarm signal failed." );
 	}
 
-	/* Shared memory */
-	// Creation of shared memory for simulated clock and block process array 
-	shmClockKey = 1993;
-	if ( ( shmClockID = shmget ( shmClockKey, ( 2 * ( sizeof ( unsigned int ) ) ), IPC_CREAT | 0666 ) ) == -1 ) {
-		perror ( "OSS: Failure to create shared memory space for simulated clock." );
-		return 1;
+	if ( signal ( SIGUSR1, handle ) == SIG_ERR ) {
+		perror ( "OSS: statistics signal failed." );
 	}
 
-	shmBlockedKey = 1994;
-	if ( ( shmBlockedID = shmget ( shmBlockedKey, ( totalProcessLimit * ( sizeof ( int ) ) ), IPC_CREAT | 0666 ) ) == -1 ) {
-		perror ( "OSS: Failure to create shared memory space for blocked USER process array." );
+	/* Shared memory */
+	// Remove anything left behind by crashed runs before creating this instance's objects.
+	// The keys are derived from this OSS's pid, which is passed to every USER it spawns.
+	removeStaleIPC();
+	
+	// Creation of the shared memory region holding the simulated clock and a control block for
+	//   each USER process (see SharedRegion in oss.h)
+	shmRegionKey = ipcKey ( myPid, ipcRegionObject );
+	if ( ( shmRegionID = shmget ( shmRegionKey, sizeof ( SharedRegion ), IPC_CREAT | IPC_EXCL | 0666 ) ) == -1 ) {
+		perror ( "OSS: Failure to create shared memory region." );
 		return 1;
 	}
 	
-	// Attach to and initialize shared memory for clock and blocked process array
-	if ( ( shmClock = (unsigned int *) shmat ( shmClockID, NULL, 0 ) ) < 0 ) {
-		perror ( "OSS: Failure to attach to shared memory space for simulated clock." );
+	// Attach to and initialize the region
+	if ( ( shmRegion = (SharedRegion *) shmat ( shmRegionID, NULL, 0 ) ) == (void *) -1 ) {
+		perror ( "OSS: Failure to attach to shared memory region." );
 		return 1;
 	}
+	shmClock = shmRegion->clock.time;
 	shmClock[0] = 0; // Will hold the seconds value for the simulated clock
 	shmClock[1] = 0; // Will hold the nanoseconds value for the simulated clock
 
-	if ( ( shmBlocked = (int *) shmat ( shmBlockedID, NULL, 0 ) ) < 0 ) {
-		perror ( "OSS: Failure to attach to shared memory space for blocked USER process array." );
-		return 1;
-	}
-	
-	// This table has index to correspond with each USER process. 
-	// If the process is ever blocked by OSS, that flag at its corresponding index
-	//  will get flipped to 1 to indicate that it is blocked. 
+	// Each control block has index to correspond with each USER process.
+	// If the process is ever blocked by OSS, its blocked flag will get flipped to 1.
 	// The flag will be flipped back to 0 once it is no longer blocked and has been
 	//  granted its requested resource.
 	for ( i = 0; i < totalProcessLimit; ++i ) {
-		shmBlocked[i] = 0;
+		resetProcessControl ( &shmRegion->process[i] );
 	}
+	memset ( shmRegion->profile, 0, sizeof ( shmRegion->profile ) );	// USERs add to these (see profile.c)
+	
+	// The header is filled in last; USER refuses to run against a region it does not match
+	shmRegion->header.version = sharedRegionVersion;
+	shmRegion->header.regionSize = sizeof ( SharedRegion );
+	shmRegion->header.processSlots = maxProcesses;
+	shmRegion->header.resourceTypes = maxResources;
+	shmRegion->header.profiling = profiling;
+	shmRegion->header.magic = sharedRegionMagic;
 	
 	// Creation of message queue
-	messageKey = 1996;
-	if ( ( messageID = msgget ( messageKey, IPC_CREAT | 0666 ) ) == -1 ) {
+	messageKey = ipcKey ( myPid, ipcMessageObject );
+	if ( ( messageID = msgget ( messageKey, IPC_CREAT | IPC_EXCL | 0666 ) ) == -1 ) {
 		perror ( "OSS: Failure to create the message queue." );
 		return 1;
 	}
 
 	/* Creation of different data tables */
 	// Table storing the total resources in the system.
-	// Number of each resource is a random number between 1-10 (inclusive).
-	int totalResourceTable[20]; 
-	for ( i = 0; i < 20; ++i ) {
-		totalResourceTable[i] = ( rand() % ( 10 - 1 + 1 ) + 1 );
-	}
-
-	// Table storing the max claims of each resource for each process.
-	// Each row will be updated by on the index of created process upon creation by OSS.
-	// Initialize to 0.
-	int maxClaimTable[totalProcessLimit][20];
-	for ( i = 0; i < totalProcessLimit; ++i ) {
-		for ( j = 0; j < 20; ++j ) {
-			maxClaimTable[i][j] = 0;
-		}
+	// Number of each resource is a random number between resourceTotalLower-resourceTotalUpper (inclusive, 1-10 by default).
+	// The manager starts with all of it available, and no claims or allocations.
+	int totalResourceTable[maxResources]; 
+	for ( i = 0; i < maxResources; ++i ) {
+		totalResourceTable[i] = ( rand() % ( resourceTotalUpper - resourceTotalLower + 1 ) + resourceTotalLower );
 	}
-
-	// Table storing the amount of each resource currently allocated to each process.
-	// Updated by OSS whenever resources are granted or released. 
-	// Initialize to 0.
-	int allocatedTable[totalProcessLimit][20];
-	for ( i = 0; i < totalProcessLimit; ++i ) {
-		for ( j = 0; j < 20; ++j ) {
-			allocatedTable[i][j] = 0;
-		}
+	if ( !resmgrInit ( &manager, totalResourceTable ) ) {
+		perror ( "OSS: Failure to set up the resource manager." );
+		return 1;
 	}
+	manager.verify = verifySafety;
 	
-	// Table storing the amount of resources currently available to the system.
-	// Updated by OSS whenever resources are granted or released. 
-	// (Values are the difference of total resources and currently allocated resources.
-	// Initialize as equal to the totalResourceTable
-	int availableResourcesTable[20];
-	for ( i = 0; i < 20; ++i ) {
-		availableResourcesTable[i] = totalResourceTable[i];
-	}
-
-	// Table storing the requested resource if the process's request was blocked. 
-	// The resource number is stored at the index of the associated process. 
-	// OSS stores this value if it is going to put the process in the blocked queue. 
-	// OSS resets the value to -1 if the process is unblocked and then granted the resource. 
-	int requestedResourceTable[totalProcessLimit];
-	for ( i = 0; i < totalProcessLimit; ++i ) {
-		requestedResourceTable[i] = -1;
+	// Pick up a checkpointed run where it left off (the USERs that were alive are respawned below)
+	if ( restoreName != NULL ) {
+		restoreCheckpoint ( &restoredState );
+		newProcessTime[0] = shmClock[0];
+		newProcessTime[1] = shmClock[1];
 	}
 	
+	// Pick the banker's kernel for this table width (-k was checked above)
+	resmgrSelectKernel ( &manager, kernelChoice, maxAmountOfEachResource );
+	fprintf ( fp, "OSS: Using %s banker's safety kernel.\n", safetyKernelName ( manager.kernel ) );
+
 	/* Main Loop */
 	// Main loop variables
 	pid_t pid;
 	int processIndex = 0;	// Essentially the same as the process counter variable
 	int currentProcesses = 0;	// Counter to track how many processes are currently active
 	unsigned int nextRandomProcessTime;
-	unsigned int nextProcessTimeBound = 5000;	// Used as a bound when generating the random time for the next process to be created 
 	bool timeCheck, processCheck;	// Both flags need to be set to true in order for createProcess to be set to true
 	bool createProcess;	// Flag to control whether the logic to create a new process is needed or not
 	
-	Queue* blockedQueue = createQueue ( totalProcessLimit );
-	
-	// Variables used when handling received messages
-	int tempPid;
+	// Received messages are handled in place in message; these hold the blocked process being retried
 	int tempIndex;
 	int tempRequest;
-	int tempRelease;
-	bool tempTerminate;
-	bool tempGranted;
-	unsigned int tempClock[2];
-	unsigned int receivedTime[2];
-	int tempHolder; 
-	
-	// Main loop will run until the totalProcessLimit has been reached 
+	ResmgrResult retryResult;
+	ResmgrResult requestResult;
+	bool accepted;	// Whether the manager took a release or termination
+	
+	const char *limitName;	// Name of the run limit that started the drain phase
+	bool logThis;	// Whether the routine lines about the message (or retry) being handled are logged (-v)
+	
+	// Respawn the USERs that were alive when the checkpoint was taken. Each is handed what it held
+	//   and, if it was in the blocked queue, the request it is still waiting on.
+	if ( restoreName != NULL ) {
+		for ( i = 0; i < totalProcessLimit; ++i ) {
+			shmRegion->process[i].pendingRequest = -1;
+		}
+		for ( i = 0; i < restoredState.blockedCount; ++i ) {
+			shmRegion->process[restoredState.blockedQueue[i]].blocked = 1;
+			shmRegion->process[restoredState.blockedQueue[i]].pendingRequest = resmgrRequestedResource ( &manager, restoredState.blockedQueue[i] );
+		}
+		for ( i = 0; i < totalProcessLimit; ++i ) {
+			if ( !restoredState.live[i] )
+				continue;
+			if ( userClass[i] >= workloadClassCount )	// Checkpoint came from a run with more classes
+				userClass[i] = 0;
+			shmRegion->process[i].workload = workloadClasses[userClass[i]].workload;
+			userPids[i] = spawnUser ( i, myPid, manager.maximum[i], manager.allot[i], shmRegion->process[i].pendingRequest );
+			OSS_TRACE ( spawn, i, userPids[i], shmClock[0], shmClock[1] );
+			currentProcesses++;
+		}
+		fprintf ( fp, "OSS: Restored %s at %d:%d after %d messages, with %d processes alive and %d blocked.\n", restoreName, 
+			 shmClock[0], shmClock[1], totalMessagesProcessed, currentProcesses, restoredState.blockedCount );
+	}
+	
+	if ( checkpointName != NULL && !openCheckpointFile ( checkpointName ) )
+		return 1;
+	nextCheckpoint = totalMessagesProcessed + checkpointInterval;
+	nextSnapshot = totalMessagesProcessed + snapshotInterval;
+	
+	// A restored table is not all zeros, so the first snapshot has to cover every row
+	for ( i = 0; i < totalProcessLimit; ++i ) {
+		manager.dirtyRows[i] = true;
+	}
+	
+	// Everything the main loop needs is in place; from here on it should not allocate
+	loopStartAllocations = heapAllocations;
+	profileStart();
+	
+	// Main loop will run until a run limit is reached and the drain phase has finished,
+	//   or until every one of the totalProcessLimit processes has been created and has terminated
 	while ( 1 ) {
+		profileLoopPass();
+		
+		// Check the run limits (including the logfile length) after the most recent run through the loop.
+		// Once one is reached, stop creating processes and let the live ones finish.
+		// The notices that the run is stopping and has finished are written even to a full log.
+		if ( !draining && ( limitName = runLimitReached ( logStreamLines() ) ) != NULL ) {
+			fprintf ( fp, "OSS: Run limit reached (%s) at %d:%d. Waiting for %d processes to finish...\n", 
+				 limitName, shmClock[0], shmClock[1], currentProcesses );
+			if ( logLineLimit > 0 && strcmp ( limitName, "logfile length" ) == 0 )
+				fprintf ( stderr, "OSS: Stopping at the %d line logfile limit (-L 0 or -g to log without one).\n", logLineLimit );
+			draining = 1;
+			alarm ( drainTimer );	// A USER that never finishes can't hold up the report forever
+			
+			// Keep the state as it was when the run stopped, with its processes still alive, so it can be resumed
+			if ( checkpointName != NULL )
+				saveCheckpoint();
+		}
 		
-		// Check the number of lines in the logfile after the most recent run through the loop.
-		// Terminate if logfile exceeds 10000 lines (per project instruction ).
-		if ( numberOfLines >= 10000 ) {
-			fprintf ( fp, "OSS: Logfile has exceeded it's maximum length. Program terminating...\n" );
-			kill ( getpid(), SIGINT );
+		// Done once nothing is alive and no more processes will be created
+		if ( currentProcesses == 0 && ( draining || totalProcessesCreated == totalProcessLimit ) ) {
+			fprintf ( fp, "OSS: All processes have finished at %d:%d.\n", shmClock[0], shmClock[1] );
+			break;
 		}
 		
+		// Pick up USERs that have exited. One that died without telling OSS gets a termination
+		//   message on its behalf so its resources are returned.
+		profileEnter ( phaseReap );
+		reapUsers();
+		profileLeave();
+		
 		createProcess = false;	// Flag is false by default each run through the loop
 
 		// Check first to see if it is time to create a new process
@@ -216,79 +526,39 @@ int main ( int argc, char *argv[] ) {
 		
 		// Check to see if timeCheck and processCheck flags are set to true. 
 		// If they both are, set the flag to true as well.
-		if ( ( timeCheck == true ) && ( processCheck == true ) ) {
+		if ( ( timeCheck == true ) && ( processCheck == true ) && !draining ) {
 			createProcess = true;
 		}
 
 		// If the flag gets set to true, continue to create the new process.
-		// Randomly create the new USER's max claim vector. Update maxClaimTable for current index.
+		// Randomly create the new USER's max claim vector and register it with the manager.
 		// Perform fork and exec passing the process's index and resource vector to USER. 
 		if ( createProcess ) {
+			profileEnter ( phaseSpawn );
 			processIndex = totalProcessesCreated;	// Sets process index for the various resource tables
-			for ( i = 0; i < 20; ++i ) {
-				maxClaimTable[processIndex][i] = ( rand() % ( maxAmountOfEachResource - 1 + 1 ) + 1 ); 
+			// The manager caps each claim at the resource's total (see resmgrRegisterProcess())
+			int claims[maxResources];
+			for ( i = 0; i < maxResources; ++i ) {
+				claims[i] = ( rand() % ( maxAmountOfEachResource - 1 + 1 ) + 1 ); 
 			}
+			resmgrRegisterProcess ( &manager, processIndex, claims );
 			
-			fprintf ( fp, "Max Claim Vector for new newly generated process: Process %d\n", processIndex);
-			for ( i = 0; i < 20; ++i ) {
-				fprintf ( fp, "%d: %d\t", i, maxClaimTable[processIndex][i] );
-			}
-			fprintf ( fp, "\n" );
+			// Only draw a class when there is a choice, so runs without a profile keep their random sequence
+			userClass[processIndex] = workloadClassCount > 1 ? pickWorkloadClass ( workloadClasses, workloadClassCount ) : 0;
 			
-			pid = fork();	// Fork the process
-
-			// The fork failed...
-			if ( pid < 0 ) {
-				perror ( "OSS: Failure to fork child process." );
-				kill ( getpid(), SIGINT );
+			// The claim is built up first so it goes to the log as one line
+			char claimLine[maxResources * 24];
+			int claimLength = 0;
+			for ( i = 0; i < maxResources; ++i ) {
+				claimLength += snprintf ( claimLine + claimLength, sizeof ( claimLine ) - claimLength, "%d: %d\t", i,
+							  manager.maximum[processIndex][i] );
 			}
-
-			// In the child process...
-			if ( pid == 0 ) {
-				// 21 integer buffers to convert process index and resource vector to string.
-				// Once converted, all of the buffers will be passed to USER with execl.
-				char intBuffer0[3], intBuffer1[3], intBuffer2[3], intBuffer3[3], intBuffer4[3];
-				char intBuffer5[3], intBuffer6[3], intBuffer7[3], intBuffer8[3], intBuffer9[3];
-				char intBuffer10[3], intBuffer11[3], intBuffer12[3], intBuffer13[3], intBuffer14[3];
-				char intBuffer15[3], intBuffer16[3], intBuffer17[3], intBuffer18[3], intBuffer19[3];
-				char intBuffer20[3];
-
-				// The buffer number corresponds with that resource in the maxClaimTable.
-				sprintf ( intBuffer0, "%d", maxClaimTable[processIndex][0] );	// resource0
-				sprintf ( intBuffer1, "%d", maxClaimTable[processIndex][1] );	// resource1
-				sprintf ( intBuffer2, "%d", maxClaimTable[processIndex][2] );	// resource2
-				sprintf ( intBuffer3, "%d", maxClaimTable[processIndex][3] );	// resource3
-				sprintf ( intBuffer4, "%d", maxClaimTable[processIndex][4] );	// resource4
-				sprintf ( intBuffer5, "%d", maxClaimTable[processIndex][5] );	// resource5
-				sprintf ( intBuffer6, "%d", maxClaimTable[processIndex][6] );	// resource6
-				sprintf ( intBuffer7, "%d", maxClaimTable[processIndex][7] );	// resource7
-				sprintf ( intBuffer8, "%d", maxClaimTable[processIndex][8] );	// resource8
-				sprintf ( intBuffer9, "%d", maxClaimTable[processIndex][9] );	// resource9
-				sprintf ( intBuffer10, "%d", maxClaimTable[processIndex][10] );	// resource10
-				sprintf ( intBuffer11, "%d", maxClaimTable[processIndex][11] );	// resource11
-				sprintf ( intBuffer12, "%d", maxClaimTable[processIndex][12] );	// resource12
-				sprintf ( intBuffer13, "%d", maxClaimTable[processIndex][13] );	// resource13
-				sprintf ( intBuffer14, "%d", maxClaimTable[processIndex][14] );	// resource14
-				sprintf ( intBuffer15, "%d", maxClaimTable[processIndex][15] );	// resource15
-				sprintf ( intBuffer16, "%d", maxClaimTable[processIndex][16] );	// resource16
-				sprintf ( intBuffer17, "%d", maxClaimTable[processIndex][17] );	// resource17
-				sprintf ( intBuffer18, "%d", maxClaimTable[processIndex][18] );	// resource18
-				sprintf ( intBuffer19, "%d", maxClaimTable[processIndex][19] );	// resource19
-				sprintf ( intBuffer20, "%d", processIndex );	// processIndex
-
-				fprintf ( fp, "OSS: Process %d (PID: %d) was created at %d:%d.\n", processIndex, 
-					 getpid(), shmClock[0], shmClock[1] );
-				numberOfLines++;
-				
-				// Exec to USER passing the appropriate information
-				execl ( "./user", "user", intBuffer0, intBuffer1, intBuffer2, intBuffer3,
-				       intBuffer4, intBuffer5, intBuffer6, intBuffer7, intBuffer8, 
-				       intBuffer9, intBuffer10, intBuffer11, intBuffer12, intBuffer13, 
-				       intBuffer14, intBuffer15, intBuffer16, intBuffer17, intBuffer18,
-				       intBuffer19, intBuffer20, NULL );
-
-				exit ( 127 );
-			} // End of child process logic for OSS
+			logLine ( "Max Claim Vector for new newly generated process: Process %d (class %s)\n%s\n", processIndex,
+				 workloadClasses[userClass[processIndex]].name, claimLine );
+			
+			resetProcessControl ( &shmRegion->process[processIndex] );
+			shmRegion->process[processIndex].workload = workloadClasses[userClass[processIndex]].workload;
+			pid = spawnUser ( processIndex, myPid, manager.maximum[processIndex], NULL, -1 );
 
 			// In the parent process...
 			// Set the time for the next process to be created
@@ -304,192 +574,276 @@ int main ( int argc, char *argv[] ) {
 			processCheck = false;
 						 
 			// Manage process counters
+			userPids[processIndex] = pid;
+			OSS_TRACE ( spawn, processIndex, pid, shmClock[0], shmClock[1] );
 			currentProcesses++;
 			totalProcessesCreated++;
+			profileLeave();
 		}
 		
 		// Check for message...
-		msgrcv ( messageID, &message, sizeof( message ), 5, IPC_NOWAIT );
+		// If there is none, clear the fields so last iteration's message isn't handled twice.
+		// An empty poll counts as idle time in the profile.
+		profileEnter ( phaseReceive );
+		if ( msgrcv ( messageID, &message, sizeof( message ), 5, IPC_NOWAIT ) == -1 ) {
+			profileLeaveAs ( phaseIdle );
+			message.request = -1;
+			message.release = -1;
+			message.terminate = false;
+		} else {
+			profileLeave();
+			totalMessagesProcessed++;
+			OSS_TRACE ( message_receive, message.tableIndex, 
+				   message.request != -1 ? message.request : message.release, 
+				   message.messageTime[0], message.messageTime[1] );
+		}
 		
-		// Set variables based on received message...
-		tempPid = message.pid;
-		tempIndex = message.tableIndex;
-		tempRequest = message.request;
-		tempRelease = message.release;
-		tempTerminate = message.terminate;
-		tempGranted = message.resourceGranted;
-		tempClock[0] = message.messageTime[0];
-		tempClock[1] = message.messageTime[1];
+		// A terminating USER is exiting and reads no replies, so only its termination is handled
+		if ( message.terminate == true ) {
+			message.request = -1;
+			message.release = -1;
+		}
 		
+		// The received message is handled in place; replies are built in reply.
 		// Resource Request Message
-		if ( tempRequest != -1 ) {
-			fprintf ( fp, "OSS: Process %d requested Resource %d at %d:%d.\n", tempIndex, 
-				 tempRequest, tempClock[0], tempClock[1] );
-			numberOfLines++;
-			totalResourcesRequested++;
-			
-			// Store that requested resource value in the request vector for that process.
-			requestedResourceTable[tempIndex] = tempRequest;
-			
-			// Temporarily change the resource tables to test the state
-			allocatedTable[tempIndex][tempRequest]++;
-			availableResourcesTable[tempRequest]--;
+		if ( message.request != -1 ) {
+			logThis = logRoutineEvent();
+			if ( logThis )
+				logLine ( "OSS: Process %d requested Resource %d at %d:%d.\n", message.tableIndex, 
+					 message.request, message.messageTime[0], message.messageTime[1] );
 			
-			// Run banker's algorithm...
-			// If the state is safe, send the USER a message granting the resource request.
-			// Update the tables.
-			if (isSafeState ( availableResourcesTable, maxClaimTable, allocatedTable ) ) {
-				totalRequestsGranted++;
-				message.msg_type = tempIndex;
-				message.pid = getpid();
-				message.tableIndex = tempIndex;
-				message.request = -1;
-				message.release = -1;
-				message.terminate = false;
-				message.resourceGranted = true;
-				message.messageTime[0] = shmClock[0];
-				message.messageTime[1] = shmClock[1];
+			// Run banker's algorithm on the request (see resmgr.c)...
+			// If the state is safe, the tables are updated and the USER is sent a message granting it.
+			requestResult = requestResource ( message.tableIndex, message.request );
+			if ( requestResult == resmgrGranted ) {
+				recordLatency ( manager.requestTime[message.tableIndex], simulatedTime() );
+				profileEnter ( phaseReply );
+				reply.msg_type = userPids[message.tableIndex];	// USER waits for replies addressed to its PID
+				reply.pid = getpid();
+				reply.tableIndex = message.tableIndex;
+				reply.request = -1;
+				reply.release = -1;
+				reply.terminate = false;
+				reply.resourceGranted = true;
+				reply.messageTime[0] = shmClock[0];
+				reply.messageTime[1] = shmClock[1];
+				
+				// Fill the reply slot before the message wakes USER up
+				shmRegion->process[message.tableIndex].replyResource = message.request;
+				shmRegion->process[message.tableIndex].replyTime[0] = shmClock[0];
+				shmRegion->process[message.tableIndex].replyTime[1] = shmClock[1];
 				
-				if ( msgsnd ( messageID, &message, sizeof ( message ), 0 ) == -1 ) {
+				if ( msgsnd ( messageID, &reply, sizeof ( reply ), 0 ) == -1 ) {
 					perror ( "OSS: Failure to send message." );
 				}
+				profileLeave();
 				
-				fprintf ( fp, "OSS: Process %d was granted its request of Resource %d at %d:%d.\n", 
-					 tempIndex, tempRequest, shmClock[0], shmClock[1] );
-				numberOfLines++;				
+				OSS_TRACE ( grant, message.tableIndex, message.request, shmClock[0], shmClock[1] );
+				if ( logThis )
+					logLine ( "OSS: Process %d was granted its request of Resource %d at %d:%d.\n", 
+						 message.tableIndex, message.request, shmClock[0], shmClock[1] );
+			}
+			// A request the manager refused outright (past the claim, from a process that isn't live or
+			//   is already blocked) is not queued, so USER is told it was denied instead of being blocked
+			else if ( requestResult == resmgrInvalid ) {
+				if ( !logThis )
+					logLine ( "OSS: Process %d requested Resource %d at %d:%d.\n", message.tableIndex, 
+						 message.request, message.messageTime[0], message.messageTime[1] );
+				logLine ( "OSS: Process %d made an invalid request of Resource %d, which was denied at %d:%d.\n", 
+					 message.tableIndex, message.request, shmClock[0], shmClock[1] );
+				if ( message.tableIndex >= 0 && message.tableIndex < maxProcesses && userPids[message.tableIndex] > 0 ) {
+					reply.msg_type = userPids[message.tableIndex];
+					reply.pid = getpid();
+					reply.tableIndex = message.tableIndex;
+					reply.request = -1;
+					reply.release = -1;
+					reply.terminate = false;
+					reply.resourceGranted = false;
+					reply.messageTime[0] = shmClock[0];
+					reply.messageTime[1] = shmClock[1];
+					if ( msgsnd ( messageID, &reply, sizeof ( reply ), 0 ) == -1 ) {
+						perror ( "OSS: Failure to send message." );
+					}
+				}
 			}
-			// if it's unsafe, block the user in shm and add to queue
-			// update logfile
+			// if it's unsafe, the manager has put the process in the blocked queue;
+			// block the user in shm and update logfile
 			else {
-				// Reset tables to their state before the test
-				allocatedTable[tempIndex][tempRequest]--;
-				availableResourcesTable[tempRequest]++;
-				
-				// Place that process's index in the blocked queue
-				enqueue ( blockedQueue, tempIndex );
-				
 				// Set the blocked process flag in shared memory for USER to see
-				shmBlocked[tempIndex] = 1;
+				shmRegion->process[message.tableIndex].blocked = 1;
+				OSS_TRACE ( block, message.tableIndex, message.request, shmClock[0], shmClock[1] );
 				
-				fprintf ( fp, "OSS: Process %d was denied its request of Resource %d and was blocked at %d:%d.\n", 
-					 tempIndex, tempRequest, shmClock[0], shmClock[1] );
-				numberOfLines++;
+				// Blocks are always logged, with the request that caused them
+				if ( !logThis )
+					logLine ( "OSS: Process %d requested Resource %d at %d:%d.\n", message.tableIndex, 
+						 message.request, message.messageTime[0], message.messageTime[1] );
+				logLine ( "OSS: Process %d was denied its request of Resource %d and was blocked at %d:%d.\n", 
+					 message.tableIndex, message.request, shmClock[0], shmClock[1] );
 			}
+			checkVerifiedSafety ( message.tableIndex, message.request );
 			
 			incrementClock ( shmClock );
 		}
 		
 		// Resource Release Message
-		if ( tempRelease != -1 ) {
-			fprintf ( fp, "OSS: Process %d indicated that it was releasing some of Resource %d at %d:%d.\n", 
-				 tempIndex, tempRelease, tempClock[0], tempClock[1] );
-			numberOfLines++;
+		if ( message.release != -1 ) {
+			logThis = logRoutineEvent();
+			if ( logThis )
+				logLine ( "OSS: Process %d indicated that it was releasing some of Resource %d at %d:%d.\n", 
+					 message.tableIndex, message.release, message.messageTime[0], message.messageTime[1] );
 			
-			totalResourcesReleased++;
-			allocatedTable[tempIndex][tempRelease]--;
-			availableResourcesTable[tempRelease]++;
-	
-			fprintf ( fp, "OSS: Process %d release notification was handled at %d:%d.\n", tempIndex, shmClock[0],
-				 shmClock[1] );
-			numberOfLines++;
+			profileEnter ( phaseBanker );
+			accepted = false;
+			if ( message.release >= 0 && message.release < maxResources ) {
+				requestVector[message.release] = 1;
+				accepted = resmgrRelease ( &manager, message.tableIndex, requestVector, simulatedTime() );
+				requestVector[message.release] = 0;
+			}
+			profileLeave();
+			
+			if ( accepted ) {
+				OSS_TRACE ( release, message.tableIndex, message.release, shmClock[0], shmClock[1] );
+				if ( logThis )
+					logLine ( "OSS: Process %d release notification was handled at %d:%d.\n", message.tableIndex, shmClock[0],
+						 shmClock[1] );
+			} else {
+				// Nothing is changed for a release of units the process doesn't hold
+				logLine ( "OSS: Process %d tried to release Resource %d, which it doesn't hold, at %d:%d.\n", 
+					 message.tableIndex, message.release, shmClock[0], shmClock[1] );
+			}
 			incrementClock ( shmClock );
 		}
 		
 		// Process Termination Message
-		if ( tempTerminate == true ) {
-			fprintf ( fp, "OSS: Process %d terminated at %d:%d.\n", tempIndex, tempClock[0], tempClock[1] );
-			numberOfLines++;
+		if ( message.terminate == true ) {
+			// Return everything it held and clear its claim, so the finished process no longer
+			//   counts against the safety check.
+			profileEnter ( phaseBanker );
+			accepted = resmgrTerminate ( &manager, message.tableIndex, simulatedTime() );
+			profileLeave();
 			
-			for ( i = 0; i < 20; ++i ) {
-				tempHolder = allocatedTable[tempIndex][i];
-				allocatedTable[tempIndex][i] = 0;
-				availableResourcesTable[i] += tempHolder;
+			// A second termination of the same process (e.g. reapUsers() sending one for a USER
+			//   that had already sent its own) changes nothing and isn't counted
+			if ( accepted ) {
+				logLine ( "OSS: Process %d terminated at %d:%d.\n", message.tableIndex, message.messageTime[0], message.messageTime[1] );
+				userPids[message.tableIndex] = 0;
+				currentProcesses--;
+				totalProcessesTerminated++;
+				OSS_TRACE ( terminate, message.tableIndex, -1, shmClock[0], shmClock[1] );
+				
+				logLine ( "OSS: Process %ds termination notification was handled at %d:%d.\n", message.tableIndex, 
+					 shmClock[0], shmClock[1] );
+			} else {
+				logLine ( "OSS: Repeated termination of Process %d was ignored at %d:%d.\n", message.tableIndex, 
+					 shmClock[0], shmClock[1] );
 			}
-			currentProcesses--;
-			
-			fprintf ( fp, "OSS: Process %ds termination notification was handled at %d:%d.\n", tempIndex, 
-				 shmClock[0], shmClock[1] );
-			numberOfLines++;
 			incrementClock ( shmClock );
 		}
 		
 		// Check blocked queue
-		if ( !isEmpty ) {
-			// Dequeue the next item from the queue, store its index and find the
-			//   requested resource which had it caused it to get blocked.
-			tempIndex = dequeue ( blockedQueue );
-			tempRequest = requestedResourceTable[tempIndex]; 
-			totalResourcesRequested++;
-			
-			// Temporarily change the resource tables to test the state
-			allocatedTable[tempIndex][tempRequest]++;
-			availableResourcesTable[tempRequest]--;
+		// The manager retries the oldest blocked request (it is not counted as a new one).
+		// A process that died while blocked was taken out of the queue when it terminated.
+		retryResult = resmgrNothingBlocked;
+		if ( resmgrBlockedCount ( &manager ) > 0 ) {
+			profileEnter ( phaseBanker );
+			retryResult = resmgrRetryBlocked ( &manager, simulatedTime(), &tempIndex );
+			profileLeave();
+		}
+		if ( retryResult != resmgrNothingBlocked ) {
+			tempRequest = resmgrRequestedResource ( &manager, tempIndex ); 
 			
-			// Run banker's algorithm...
 			// If the state is safe, send the USER a message granting the resource request.
-			// Update the tables.
-			if (isSafeState ( availableResourcesTable, maxClaimTable, allocatedTable ) ) {
-				totalRequestsGranted++;
-				message.msg_type = tempIndex;
-				message.pid = getpid();
-				message.tableIndex = tempIndex;
-				message.request = -1;
-				message.release = -1;
-				message.terminate = false;
-				message.resourceGranted = true;
-				message.messageTime[0] = shmClock[0];
-				message.messageTime[1] = shmClock[1];
+			if ( retryResult == resmgrGranted ) {
+				recordLatency ( manager.requestTime[tempIndex], simulatedTime() );
+				profileEnter ( phaseReply );
+				reply.msg_type = userPids[tempIndex];	// USER waits for replies addressed to its PID
+				reply.pid = getpid();
+				reply.tableIndex = tempIndex;
+				reply.request = -1;
+				reply.release = -1;
+				reply.terminate = false;
+				reply.resourceGranted = true;
+				reply.messageTime[0] = shmClock[0];
+				reply.messageTime[1] = shmClock[1];
 				
-				if ( msgsnd ( messageID, &message, sizeof ( message ), 0 ) == -1 ) {
+				// Fill the reply slot before the message wakes USER up
+				shmRegion->process[tempIndex].replyResource = tempRequest;
+				shmRegion->process[tempIndex].replyTime[0] = shmClock[0];
+				shmRegion->process[tempIndex].replyTime[1] = shmClock[1];
+				
+				if ( msgsnd ( messageID, &reply, sizeof ( reply ), 0 ) == -1 ) {
 					perror ( "OSS: Failure to send message." );
 				}
+				profileLeave();
 				
-				// Set the blocked process flag in shared memory for USER to see
-				shmBlocked[tempIndex] = 0;
+				// Clear the blocked process flag in shared memory for USER to see
+				shmRegion->process[tempIndex].blocked = 0;
+				OSS_TRACE ( grant, tempIndex, tempRequest, shmClock[0], shmClock[1] );
+				OSS_TRACE ( unblock, tempIndex, tempRequest, shmClock[0], shmClock[1] );
 				
-				fprintf ( fp, "OSS: Process %d was granted its request of Resource %d at %d:%d.\n", 
+				logLine ( "OSS: Process %d was granted its request of Resource %d at %d:%d.\n", 
 					 tempIndex, tempRequest, shmClock[0], shmClock[1] );
-				numberOfLines++;				
-			} else {
-				// Reset tables to their state before the test
-				allocatedTable[tempIndex][tempRequest]--;
-				availableResourcesTable[tempRequest]++;
-				
-				// Place that process's index in the blocked queue
-				enqueue ( blockedQueue, tempIndex );
-				
+			} else if ( retryResult == resmgrBlocked ) {
 				// Set the blocked process flag in shared memory for USER to see
-				shmBlocked[tempIndex] = 1;
+				shmRegion->process[tempIndex].blocked = 1;
 				
-				fprintf ( fp, "OSS: Process %d was denied it's request of Resource %d and was blocked at %d:%d.\n", 
-					 tempIndex, tempRequest, shmClock[0], shmClock[1] );
-				numberOfLines++;
+				// The process was already blocked, so a failed retry is routine. While draining the
+				//   same few requests are retried on every pass, so those aren't logged at all.
+				if ( !draining && logRoutineEvent() )
+					logLine ( "OSS: Process %d was denied it's request of Resource %d and was blocked at %d:%d.\n", 
+						 tempIndex, tempRequest, shmClock[0], shmClock[1] );
 			}
+			checkVerifiedSafety ( tempIndex, tempRequest );
 			incrementClock ( shmClock );
 		}
 		
 		incrementClock ( shmClock );
 		
-		if ( numberOfLines % 20 == 0 ) {
-			//printAllocatedResourcesTable( totalProcessesCreated, allocatedTable );
-			fprintf ( fp, "Currently Allocated Resources\n" );
-			fprintf ( fp, "\tR0\tR1\tR2\tR3\tR4\tR5\tR6\tR7\tR8\tR9\tR10\tR11\tR12\tR13\tR14\tR15\tR16\tR17\tR18\tR19\n" );
-			for ( i = 0; i < totalProcessesCreated; ++i ) {
-				fprintf ( fp, "P%d:\t", i );
-				for ( j = 0; j < 20; ++j ) {
-					fprintf ( fp, "%d\t", allocatedTable[i][j] );
-				}
-				fprintf ( fp, "\n" );
-			}
-		}			
+		// Live statistics (kill -USR1 <OSS pid>), printed here rather than in the handler
+		if ( statsRequested ) {
+			statsRequested = 0;
+			fprintf ( fp, "OSS: Statistics at %d:%d\n", shmClock[0], shmClock[1] );
+			printReport();
+			fflush ( stdout );
+			flushLogStream();
+		}
+		
+		// Periodic checkpoint, taken between messages so the tables and the blocked queue agree
+		if ( checkpointName != NULL && !draining && totalMessagesProcessed >= nextCheckpoint ) {
+			saveCheckpoint();
+			nextCheckpoint = totalMessagesProcessed + checkpointInterval;
+		}
+		
+		// Snapshot of the allocation rows that changed. Writes nothing if none did.
+		if ( totalMessagesProcessed >= nextSnapshot ) {
+			profileEnter ( phaseSnapshot );
+			writeAllocationSnapshot ( manager.allot, false );
+			profileLeave();
+			nextSnapshot = totalMessagesProcessed + snapshotInterval;
+		}
+		
+		// A new log segment opens with every row in use, so it can be rebuilt from once older ones are deleted
+		if ( logSegmentStarted() ) {
+			profileEnter ( phaseSnapshot );
+			writeAllocationSnapshot ( manager.allot, true );
+			profileLeave();
+		}
 			
 	} // End main loop
+	
+	// Final snapshot, so the table can be rebuilt right up to the end of the run
+	writeAllocationSnapshot ( manager.allot, false );
 
 	// Print program stats
 	printReport();
+	writeResultRow();
 						 
 	// Detach from and delete shared memory segments / message queue
 	terminateIPC();
+	resmgrDestroy ( &manager );
+	
+	// Collect any USERs that exited after their termination was handled
+	while ( wait ( NULL ) > 0 );
 
 	return 0;
 } // End main
@@ -498,98 +852,474 @@ int main ( int argc, char *argv[] ) {
 /******************************************* End of Main Function **********************************************/
 /***************************************************************************************************************/
 
-// Generates the values for the ResourcesNeeded matrix used in banker's algorithm (isSafeState()).
-// Function to find the need of each process in the system.
-void calculateNeed ( int need[maxProcesses][maxResources], int maximum[maxProcesses][maxResources], int allot[maxProcesses][maxResources] ) {
-	int i, j; 
-	for ( i = 0; i < maxProcesses; ++i ) {
-		for ( j = 0; j < maxResources; ++j ) {
-			need[i][j] = maximum[i][j] - allot[i][j];
-		}
-	}
+// Hands a USER's request for one unit of a resource to the manager, which grants it if the state
+//   stays safe and otherwise puts the process in the blocked queue
+ResmgrResult requestResource ( int processIndex, int resource ) {
+	ResmgrResult result;
+	
+	if ( resource < 0 || resource >= maxResources )
+		return resmgrInvalid;
+	profileEnter ( phaseBanker );
+	requestVector[resource] = 1;
+	result = resmgrRequest ( &manager, processIndex, requestVector, simulatedTime() );
+	requestVector[resource] = 0;
+	profileLeave();
+	return result;
 }
 
-// Code adapted from a c++ version of the algorithm at https://www.geeksforgeeks.org/program-bankers-algorithm-set-1-safety-algorithm/
-// Adaptation of banker's algorithm to handle deadlock avoidance for oss. 
-bool isSafeState ( int available[], int maximum[][maxResources], int allot[][maxResources] ) {
-	totalSafeStateChecks++;
-	int index; 
-	
-	int need[maxProcesses][maxResources];
-	calculateNeed ( need, maximum, allot );	// Function to calculate need matrix
-	
-	bool finish[maxProcesses] = { 0 };
-	
-	// Make a copy of the available resources vector.
-	int work[maxResources];
-	int i; 
-	for ( i = 0; i < maxResources; ++i ) {
-		work[i] = available[i]; 
-	}
-	
-	int count = 0; 
-	// Loop runs while all processes are not finished or system is not in a safe state
-	while ( count < maxProcesses ) {
-		int p; 
-		bool found = false;
-		for ( p = 0; p < maxProcesses; ++p ) {
-			if ( finish[p] == 0 ) {
-				int j;
-				for ( j = 0; j < maxResources; ++j ) {
-					if ( need[p][j] > work[j] )
-					    break;
-				}
-				if ( j == maxResources ) {
-					int k;
-					for ( k = 0; k < maxResources; ++k ) {
-						work[k] += allot[p][k];
-					}
-					finish[p] = 1;
-					found = true;
-				}
-			}
-		}
-		
-		if ( found == false ) {
-			//return true;
-			return false;
-		}    
-	}
-	
-	return true; 
+// Differential check (-V): every decision the manager just made must match the textbook algorithm
+void checkVerifiedSafety ( int processIndex, int resource ) {
+	if ( manager.mismatches == 0 )
+		return;
 	
+	fprintf ( stderr, "OSS: %s safety check disagreed with the generic check for Process %d, Resource %d at %d:%d.\n", 
+		 safetyKernelName ( manager.kernel ), processIndex, resource, shmClock[0], shmClock[1] );
+	fprintf ( fp, "OSS: Safety check mismatch for Process %d, Resource %d. Program terminating...\n", processIndex, resource );
+	kill ( getpid(), SIGINT );
 }
 
 // Prints program statistics before the program terminates
 void printReport() {
-	double approvalPercentage = totalRequestsGranted / totalResourcesRequested;
+	double approvalPercentage = 0.0;
+	if ( manager.requests > 0 )
+		approvalPercentage = ( double ) manager.grants / manager.requests;
 	printf ( "Program Statistics\n" );
 	fprintf ( fp, "Program Statistics\n" );
 	printf ( "\t1. Total processes created: %d\n", totalProcessesCreated );
 	fprintf ( fp, "\t1. Total processes created: %d\n", totalProcessesCreated );
-	printf ( "\t2. Total resource requests: %d\n", totalResourcesRequested );
-	fprintf ( fp, "\t2. Total resource requests: %d\n", totalResourcesRequested );
-	printf ( "\t3. Total requests granted: %d\n", totalRequestsGranted );
-	fprintf ( fp, "\t3. Total requests granted: %d\n", totalRequestsGranted );
+	printf ( "\t2. Total resource requests: %d\n", manager.requests );
+	fprintf ( fp, "\t2. Total resource requests: %d\n", manager.requests );
+	printf ( "\t3. Total requests granted: %d\n", manager.grants );
+	fprintf ( fp, "\t3. Total requests granted: %d\n", manager.grants );
 	printf ( "\t4. Percentage of requests granted: %f\n", approvalPercentage );
 	fprintf ( fp, "\t4. Percentage of requests granted: %f\n", approvalPercentage );
-	printf ( "\t5. Total deadlock avoidance algorithm uses: %d\n", totalSafeStateChecks );
-	fprintf ( fp, "\t5. Total deadlock avoidance algorithm uses: %d\n", totalSafeStateChecks );
-	printf ( "\t6. Total Resources released: %d", totalResourcesReleased );
-	fprintf ( fp, "\t6. Total Resources released: %d", totalResourcesReleased );
+	printf ( "\t5. Total deadlock avoidance algorithm uses: %d\n", manager.safetyChecks );
+	fprintf ( fp, "\t5. Total deadlock avoidance algorithm uses: %d\n", manager.safetyChecks );
+	printf ( "\t6. Total Resources released: %d", manager.releases );
+	fprintf ( fp, "\t6. Total Resources released: %d", manager.releases );
 	printf ( "\n" );
 	fprintf ( fp, "\n" );
+	printf ( "\t7. Heap allocations in the main loop: %lu\n", heapAllocations - loopStartAllocations );
+	fprintf ( fp, "\t7. Heap allocations in the main loop: %lu\n", heapAllocations - loopStartAllocations );
+	
+	printHotResources ( stdout );
+	printHotResources ( fp );
+	printProfile ( stdout, logWriterCpuNs() );
+	printProfile ( fp, logWriterCpuNs() );
+}
+
+// Prints the per-resource contention statistics, hottest resource first: most blocked requests,
+//   then most safety check failures, then longest time with none available.
+void printHotResources ( FILE *out ) {
+	ResourceStats sorted[maxResources];
+	long long now = simulatedTime();
+	int i;
+	
+	// Include the time resources that are still exhausted have been at zero so far
+	memcpy ( sorted, manager.resourceStats, sizeof ( sorted ) );
+	for ( i = 0; i < maxResources; ++i ) {
+		if ( sorted[i].zeroSince >= 0 )
+			sorted[i].zeroAvailableTime += now - sorted[i].zeroSince;
+	}
+	qsort ( sorted, maxResources, sizeof ( ResourceStats ), compareHotResources );
+	
+	fprintf ( out, "Hot Resources\n" );
+	fprintf ( out, "\tRes\tReqs\tGrants\tBlocks\tBlock%%\tUnsafe\tZero(s)\tAvgWait(ms)\tMaxWait(ms)\n" );
+	for ( i = 0; i < maxResources; ++i ) {
+		fprintf ( out, "\tR%d\t%d\t%d\t%d\t%.1f\t%d\t%.3f\t%.3f\t\t%.3f\n", sorted[i].resource, sorted[i].requests, 
+			 sorted[i].grants, sorted[i].blocks, 
+			 sorted[i].requests > 0 ? 100.0 * sorted[i].blocks / sorted[i].requests : 0.0, sorted[i].safetyFailures, 
+			 sorted[i].zeroAvailableTime / 1e9, 
+			 sorted[i].waitedGrants > 0 ? sorted[i].totalWait / 1e6 / sorted[i].waitedGrants : 0.0, sorted[i].maxWait / 1e6 );
+	}
+}
+
+// Comparison function for sorting resources hottest first with qsort()
+int compareHotResources ( const void *a, const void *b ) {
+	const ResourceStats *x = a;
+	const ResourceStats *y = b;
+	
+	if ( x->blocks != y->blocks )
+		return y->blocks - x->blocks;
+	if ( x->safetyFailures != y->safetyFailures )
+		return y->safetyFailures - x->safetyFailures;
+	return ( y->zeroAvailableTime > x->zeroAvailableTime ) - ( y->zeroAvailableTime < x->zeroAvailableTime );
+}
+
+// Writes the rows of the allocated resources table that changed since the last snapshot (format in oss.h).
+// With allRows it also writes every row that is in use, so the snapshot stands on its own.
+void writeAllocationSnapshot ( int allot[][maxResources], bool allRows ) {
+	static const int emptyRow[maxResources];
+	int changedRows[maxProcesses];
+	int changedCount = 0;
+	int i, j;
+	
+	if ( logFull() )
+		return;
+	
+	// A row can be marked and still match the last snapshot, e.g. after a request was tried and rolled back
+	for ( i = 0; i < maxProcesses; ++i ) {
+		if ( !manager.dirtyRows[i] && !allRows )
+			continue;
+		manager.dirtyRows[i] = false;
+		if ( memcmp ( snapshotTable[i], allot[i], sizeof ( snapshotTable[i] ) ) != 0 ) {
+			memcpy ( snapshotTable[i], allot[i], sizeof ( snapshotTable[i] ) );
+			changedRows[changedCount++] = i;
+		} else if ( allRows && memcmp ( allot[i], emptyRow, sizeof ( emptyRow ) ) != 0 ) {
+			changedRows[changedCount++] = i;
+		}
+	}
+	if ( changedCount == 0 && !allRows )
+		return;
+	
+	fprintf ( fp, allRows ? snapshotHeader " %u:%u (%d rows, full)\n" : snapshotHeader " %u:%u (%d changed rows)\n", 
+		 shmClock[0], shmClock[1], changedCount );
+	for ( i = 0; i < changedCount; ++i ) {
+		bool empty = true;
+		
+		fprintf ( fp, "\tP%d:", changedRows[i] );
+		for ( j = 0; j < maxResources; ++j ) {
+			if ( snapshotTable[changedRows[i]][j] != 0 ) {
+				fprintf ( fp, " R%d=%d", j, snapshotTable[changedRows[i]][j] );
+				empty = false;
+			}
+		}
+		fprintf ( fp, empty ? " -\n" : "\n" );
+	}
+}
+
+// Returns the simulated clock in nanoseconds
+long long simulatedTime () {
+	return shmClock[0] * 1000000000LL + shmClock[1];
+}
+
+// Records the simulated time between a request reaching OSS and it being granted
+void recordLatency ( long long requestTime, long long grantTime ) {
+	long long latency = grantTime - requestTime;
+	
+	if ( totalLatencySamples < maxLatencySamples )
+		latencySamples[totalLatencySamples] = latency;
+	totalLatencySamples++;
+}
+
+// Comparison function for sorting latency samples with qsort()
+int compareLatency ( const void *a, const void *b ) {
+	long long x = *( const long long * ) a;
+	long long y = *( const long long * ) b;
+	return ( x > y ) - ( x < y );
+}
+
+// Appends one CSV row describing this run (configuration and results) to resultFile, if one was given.
+// The columns are listed in resultCsvHeader in oss.h. Used by sweep to collect results from many runs.
+void writeResultRow() {
+	struct timespec now;
+	double wallSeconds;
+	double simSeconds;
+	double grantRate = 0.0;
+	long long p50 = 0, p90 = 0, p99 = 0, latencyMax = 0;
+	int samples;
+	FILE *resultFp;
+	
+	if ( resultFile == NULL )
+		return;
+	
+	clock_gettime ( CLOCK_MONOTONIC, &now );
+	wallSeconds = ( now.tv_sec - runStartTime.tv_sec ) + ( now.tv_nsec - runStartTime.tv_nsec ) / 1e9;
+	simSeconds = shmClock[0] + shmClock[1] / 1e9;
+	if ( manager.requests > 0 )
+		grantRate = ( double ) manager.grants / manager.requests;
+	
+	samples = totalLatencySamples < maxLatencySamples ? totalLatencySamples : maxLatencySamples;
+	if ( samples > 0 ) {
+		qsort ( latencySamples, samples, sizeof ( long long ), compareLatency );
+		p50 = latencySamples[( samples - 1 ) * 50 / 100];
+		p90 = latencySamples[( samples - 1 ) * 90 / 100];
+		p99 = latencySamples[( samples - 1 ) * 99 / 100];
+		latencyMax = latencySamples[samples - 1];
+	}
+	
+	if ( ( resultFp = fopen ( resultFile, "a" ) ) == NULL ) {
+		perror ( "OSS: Failure to open the result file." );
+		return;
+	}
+	
+	// Written with a single fprintf on an append-mode stream so rows from parallel runs don't interleave
+	fprintf ( resultFp, "%d,%d,%u,%d,%d,%d,%d,%d,%s,%u,%d,%d,%d,%.6f,%.6f,%.1f,%d,%d,%.6f,%d,%lld,%lld,%lld,%lld,%s\n",
+		 maxRunningProcesses, maxAmountOfEachResource, nextProcessTimeBound, resourceTotalLower, 
+		 resourceTotalUpper, requestPercent, releasePercent, terminatePercent, safetyKernelName ( manager.kernel ), runSeed, 
+		 totalProcessesCreated, totalProcessesTerminated, totalMessagesProcessed, simSeconds, wallSeconds, 
+		 wallSeconds > 0 ? totalMessagesProcessed / wallSeconds : 0.0, manager.requests, 
+		 manager.grants, grantRate, manager.safetyChecks, p50, p90, p99, latencyMax, workloadName );
+	fclose ( resultFp );
+}
+
+// Prints the command line options
+void printUsage ( char *name ) {
+	printf ( "Usage: %s [options]\n", name );
+	printf ( "\t-p N\tMax USER processes alive at once (default 18, at most %d)\n", totalProcessLimit );
+	printf ( "\t-m N\tUpper bound on each entry of a USER's max claim vector (default 4)\n" );
+	printf ( "\t-n NS\tUpper bound on the simulated time between new processes (default 5000)\n" );
+	printf ( "\t-r LOW:HIGH\tRange for the random total of each resource (default 1:10)\n" );
+	printf ( "\t-w REQ:REL:TERM\tPercent chance of each USER action, adding up to 100 (default 45:45:10)\n" );
+	printf ( "\t-s SEED\tSeed for OSS and USER random numbers (default current time)\n" );
+	printf ( "\t-t SEC\tReal seconds before OSS stops and drains, 0 for no limit (default 2)\n" );
+	printf ( "\t-T SEC\tSimulated seconds before OSS stops and drains (default no limit)\n" );
+	printf ( "\t-e N\tMessages processed before OSS stops and drains (default no limit)\n" );
+	printf ( "\t-c N\tProcesses completed before OSS stops and drains (default no limit)\n" );
+	printf ( "\t-L N\tLogfile lines before OSS stops and drains, 0 for no limit (default 10000)\n" );
+	printf ( "\t-d SEC\tReal seconds the drain may take before live processes are killed (default 5)\n" );
+	printf ( "\t-l FILE\tLogfile (default prog.log)\n" );
+	printf ( "\t-o FILE\tAppend a CSV row of run statistics to FILE on exit\n" );
+	printf ( "\t-k NAME\tBanker's safety check: auto, sparse, queued, dense or generic (default auto)\n" );
+	printf ( "\t-V\tVerify every safety decision against the generic check and stop on a mismatch\n" );
+	printf ( "\t-P\tTurn off the time profile of OSS's loop and the USERs' request path\n" );
+	printf ( "\t-C FILE\tCheckpoint the resource manager state to FILE periodically and when a run limit is reached\n" );
+	printf ( "\t-i N\tMessages processed between checkpoints (default 1000)\n" );
+	printf ( "\t-R FILE\tRestore the newest checkpoint in FILE and continue that run\n" );
+	printf ( "\t-W FILE\tWorkload profile of USER client classes, replacing -w (see workload.c; default none)\n" );
+	printf ( "\t-a N\tMessages processed between allocation table snapshots in the logfile (default 20)\n" );
+	printf ( "\t-g MB[:KEEP]\tSplit the logfile into segments of MB megabytes, keeping the newest KEEP (default one file;\n" );
+	printf ( "\t\tKEEP 0 keeps all). A segmented log has no line limit unless -L is given.\n" );
+	printf ( "\t-z LEVEL\tGzip the logfile as it is written, LEVEL 1-9 (default 0, plain text)\n" );
+	printf ( "\t-v LEVEL\tLog detail: full, or sampled[:PCT] to keep PCT%% of requests, grants and releases but every\n" );
+	printf ( "\t\tblock, unblock and process start and end (default full; PCT defaults to 10)\n" );
+	printf ( "Send OSS SIGUSR1 for the statistics and hot resource table while it runs.\n" );
+}
+
+// Copies the resource manager state into the checkpoint file.
+// Only the copy happens here; the kernel writes the file back in the background.
+void saveCheckpoint () {
+	CheckpointState *state;
+	Queue *blockedQueue = manager.blockedQueue;
+	int i;
+	
+	profileEnter ( phaseCheckpoint );
+	state = beginCheckpoint();
+	state->clock[0] = shmClock[0];
+	state->clock[1] = shmClock[1];
+	state->seed = runSeed;
+	memcpy ( state->totalResources, manager.total, sizeof ( state->totalResources ) );
+	memcpy ( state->available, manager.available, sizeof ( state->available ) );
+	memcpy ( state->maximum, manager.maximum, sizeof ( state->maximum ) );
+	memcpy ( state->allot, manager.allot, sizeof ( state->allot ) );
+	memcpy ( state->requested, manager.request, sizeof ( state->requested ) );
+	memcpy ( state->requestTime, manager.requestTime, sizeof ( state->requestTime ) );
+	for ( i = 0; i < maxProcesses; ++i ) {
+		state->live[i] = userPids[i] != 0;
+	}
+	memcpy ( state->userClass, userClass, sizeof ( state->userClass ) );
+	
+	// Queue contents, front first
+	state->blockedCount = blockedQueue->size;
+	for ( i = 0; i < blockedQueue->size; ++i ) {
+		state->blockedQueue[i] = blockedQueue->array[( blockedQueue->front + i ) % blockedQueue->capacity];
+	}
+	
+	state->totalResourcesRequested = manager.requests;
+	state->totalRequestsGranted = manager.grants;
+	state->totalSafeStateChecks = manager.safetyChecks;
+	state->totalResourcesReleased = manager.releases;
+	state->totalProcessesCreated = totalProcessesCreated;
+	state->totalProcessesTerminated = totalProcessesTerminated;
+	state->totalMessagesProcessed = totalMessagesProcessed;
+	
+	commitCheckpoint();
+	profileLeave();
+}
+
+// Loads a checkpoint into the (freshly initialized) manager, clock and statistics.
+// Latency samples and the per-resource statistics are not checkpointed, so a restored run's
+//   percentiles and hot resource table only cover its own requests.
+void restoreCheckpoint ( CheckpointState *state ) {
+	int i;
+	
+	shmClock[0] = state->clock[0];
+	shmClock[1] = state->clock[1];
+	memcpy ( manager.total, state->totalResources, sizeof ( state->totalResources ) );
+	memcpy ( manager.available, state->available, sizeof ( state->available ) );
+	memcpy ( manager.maximum, state->maximum, sizeof ( state->maximum ) );
+	memcpy ( manager.allot, state->allot, sizeof ( state->allot ) );
+	memcpy ( manager.request, state->requested, sizeof ( state->requested ) );
+	memcpy ( manager.requestTime, state->requestTime, sizeof ( state->requestTime ) );
+	for ( i = 0; i < maxProcesses; ++i ) {
+		manager.live[i] = state->live[i] != 0;
+	}
+	// Checkpoints from before terminated processes were taken out of the queue can still list them
+	for ( i = 0; i < state->blockedCount; ++i ) {
+		if ( !manager.live[state->blockedQueue[i]] || manager.blocked[state->blockedQueue[i]] )
+			continue;
+		enqueue ( manager.blockedQueue, state->blockedQueue[i] );
+		manager.blocked[state->blockedQueue[i]] = true;
+	}
+	resmgrSync ( &manager, simulatedTime() );
+	memcpy ( userClass, state->userClass, sizeof ( state->userClass ) );
+	
+	manager.requests = state->totalResourcesRequested;
+	manager.grants = state->totalRequestsGranted;
+	manager.safetyChecks = state->totalSafeStateChecks;
+	manager.releases = state->totalResourcesReleased;
+	manager.terminations = state->totalProcessesTerminated;
+	totalProcessesCreated = state->totalProcessesCreated;
+	totalProcessesTerminated = state->totalProcessesTerminated;
+	totalMessagesProcessed = state->totalMessagesProcessed;
+}
+
+// Forks and execs a USER into a process slot and returns its pid.
+// USER expects the claim for each resource first (argv[1]..argv[maxResources]), then the process
+//   index, instance ID, request/release/terminate percentages and seed. A USER restored from a
+//   checkpoint is also given what it already holds and the request it is blocked on (-1 if none).
+pid_t spawnUser ( int processIndex, int instance, int claims[], int allocation[], int pendingRequest ) {
+	pid_t pid;
+	int i;
+	
+	pid = fork();	// Fork the process
+
+	// The fork failed...
+	if ( pid < 0 ) {
+		perror ( "OSS: Failure to fork child process." );
+		kill ( getpid(), SIGINT );
+	}
+
+	// In the child process...
+	if ( pid == 0 ) {
+		// Buffers to convert the max claim vector, process index and run settings to strings.
+		// Once converted, all of the buffers will be passed to USER with execv.
+		char claimBuffers[maxResources][12];
+		char allocationBuffers[maxResources][12];
+		char indexBuffer[12];
+		char instanceBuffer[12];
+		char requestBuffer[4], releaseBuffer[4], terminateBuffer[4];
+		char seedBuffer[12];
+		char pendingBuffer[12];
+		char *userArgs[2 * maxResources + 9];
+		int argCount = 0;
+
+		userArgs[argCount++] = "user";
+		// The buffer number corresponds with that resource in the max claim table.
+		for ( i = 0; i < maxResources; ++i ) {
+			sprintf ( claimBuffers[i], "%d", claims[i] );
+			userArgs[argCount++] = claimBuffers[i];
+		}
+		sprintf ( indexBuffer, "%d", processIndex );	// processIndex
+		sprintf ( instanceBuffer, "%d", instance );	// OSS instance ID used to derive the IPC keys
+		sprintf ( requestBuffer, "%d", workloadClasses[userClass[processIndex]].requestPercent );	// Chance of requesting a resource
+		sprintf ( releaseBuffer, "%d", workloadClasses[userClass[processIndex]].releasePercent );	// Chance of releasing a resource
+		sprintf ( terminateBuffer, "%d", workloadClasses[userClass[processIndex]].terminatePercent );	// Chance of terminating
+		sprintf ( seedBuffer, "%u", runSeed + processIndex );	// Seed for USER's random numbers
+		userArgs[argCount++] = indexBuffer;
+		userArgs[argCount++] = instanceBuffer;
+		userArgs[argCount++] = requestBuffer;
+		userArgs[argCount++] = releaseBuffer;
+		userArgs[argCount++] = terminateBuffer;
+		userArgs[argCount++] = seedBuffer;
+		if ( allocation != NULL ) {
+			for ( i = 0; i < maxResources; ++i ) {
+				sprintf ( allocationBuffers[i], "%d", allocation[i] );
+				userArgs[argCount++] = allocationBuffers[i];
+			}
+			sprintf ( pendingBuffer, "%d", pendingRequest );
+			userArgs[argCount++] = pendingBuffer;
+		}
+		userArgs[argCount] = NULL;
+
+		// Exec to USER passing the appropriate information
+		execv ( "./user", userArgs );
+
+		exit ( 127 );
+	} // End of child process logic for OSS
+	
+	// Logged here rather than by the child, since the log's background writer only runs in OSS
+	logLine ( "OSS: Process %d (PID: %d) was created at %d:%d.\n", processIndex, pid, shmClock[0], shmClock[1] );
+	
+	return pid;
+}
+
+// Returns the name of the first run limit that has been reached, or NULL if the run can continue
+const char *runLimitReached ( long long logLines ) {
+	if ( stopRequested )
+		return "real time";
+	if ( ( simTimeLimit[0] > 0 || simTimeLimit[1] > 0 ) && 
+	     ( shmClock[0] > simTimeLimit[0] || ( shmClock[0] == simTimeLimit[0] && shmClock[1] >= simTimeLimit[1] ) ) )
+		return "simulated time";
+	if ( eventLimit > 0 && totalMessagesProcessed >= eventLimit )
+		return "events";
+	if ( completedLimit > 0 && totalProcessesTerminated >= completedLimit )
+		return "completed processes";
+	if ( logLineLimit > 0 && logLines >= logLineLimit )
+		return "logfile length";
+	
+	return NULL;
+}
+
+// True once the logfile has as many lines as its limit (-L); with no limit, never
+bool logFull () {
+	return logLineLimit > 0 && logStreamLines() >= logLineLimit;
+}
+
+// Reaps USER processes that have exited without blocking.
+// A USER that exited abnormally (killed, or exec failed) never sent its termination message,
+//   so one is queued for it and handled like any other termination.
+void reapUsers() {
+	pid_t pid;
+	int status;
+	int i;
+	
+	while ( ( pid = waitpid ( -1, &status, WNOHANG ) ) > 0 ) {
+		if ( WIFEXITED ( status ) && WEXITSTATUS ( status ) == EXIT_SUCCESS )
+			continue;
+		
+		for ( i = 0; i < maxProcesses; ++i ) {
+			if ( userPids[i] == pid )
+				break;
+		}
+		if ( i == maxProcesses )
+			continue;
+		
+		reply.msg_type = 5;
+		reply.pid = pid;
+		reply.tableIndex = i;
+		reply.request = -1;
+		reply.release = -1;
+		reply.terminate = true;
+		reply.resourceGranted = false;
+		reply.messageTime[0] = shmClock[0];
+		reply.messageTime[1] = shmClock[1];
+		
+		if ( msgsnd ( messageID, &reply, sizeof ( reply ), 0 ) == -1 ) {
+			perror ( "OSS: Failure to send message." );
+		}
+	}
 }
 
 // Function for signal handling.
-// Handles ctrl-c from keyboard or eclipsing 2 real life seconds in run-time.
+// Handles ctrl-c from keyboard or the real-time alarm. SIGUSR1 asks for the live statistics.
+// The first alarm only asks the main loop to drain; ctrl-c, or the alarm firing again because
+//   the drain took longer than drainTimer, stops everything immediately.
 void handle ( int sig_num ) {
+	if ( sig_num == SIGUSR1 ) {
+		statsRequested = 1;
+		return;
+	}
+	
+	if ( sig_num == SIGALRM && !draining ) {
+		stopRequested = 1;
+		return;
+	}
+	
 	if ( sig_num == SIGINT || sig_num == SIGALRM ) {
 		printf ( "Signal to terminate was received.\n" );
 		printReport();
+		writeResultRow();
 		terminateIPC();
-		kill ( 0, SIGKILL );
-		wait ( NULL );
+		
+		// Only kill the USERs this OSS created. Signalling the whole process group would also
+		//   take down any other OSS instances started from the same shell.
+		int i;
+		for ( i = 0; i < maxProcesses; ++i ) {
+			if ( userPids[i] > 0 )
+				kill ( userPids[i], SIGKILL );
+		}
+		while ( wait ( NULL ) > 0 );
 		exit ( 0 );
 	}
 }
@@ -600,10 +1330,13 @@ void printAllocatedResourcesTable( int num1, int array[][maxResources] ) {
 	num1 = totalProcessesCreated;
 	
 	printf ( "Currently Allocated Resources\n" );
-	printf ( "\tR0\tR1\tR2\tR3\tR4\tR5\tR6\tR7\tR8\tR9\tR10\tR11\tR12\tR13\tR14\tR15\tR16\tR17\tR18\tR19\n" );
+	for ( j = 0; j < maxResources; ++j ) {
+		printf ( "\tR%d", j );
+	}
+	printf ( "\n" );
 	for ( i = 0; i < totalProcessesCreated; ++i ) {
 		printf ( "P%d:\t", i );
-		for ( j = 0; j < 20; ++j ) {
+		for ( j = 0; j < maxResources; ++j ) {
 			printf ( "%d\t", array[i][j] );
 		}
 		printf ( "\n" );
@@ -616,101 +1349,119 @@ void printMaxClaimTable( int num1, int array[][maxResources] ){
 	num1 = totalProcessesCreated; 
 	
 	printf ( "Max Claim Table\n" );
-	printf ( "\tR0\tR1\tR2\tR3\tR4\tR5\tR6\tR7\tR8\tR9\tR10\tR11\tR12\tR13\tR14\tR15\tR16\tR17\tR18\tR19\n" );
+	for ( j = 0; j < maxResources; ++j ) {
+		printf ( "\tR%d", j );
+	}
+	printf ( "\n" );
 	for ( i = 0; i < totalProcessesCreated; ++i ) {
 		printf ( "P%d:\t", i );
-		for ( j = 0; j < 20; ++j ) {
+		for ( j = 0; j < maxResources; ++j ) {
 			printf ( "%d\t", array[i][j] );
 		}
 		printf ( "\n" );
 	}
 }
 
-// Function that increments the clock by some amount of time at different points. 
-// Also makes sure that nanoseconds are converted to seconds when appropriate.
-void incrementClock ( unsigned int shmClock[] ) {
-	int processingTime = 5000; // Can be changed to adjust how much the clock is incremented.
-	shmClock[1] += processingTime;
-
-	shmClock[0] += shmClock[1] / 1000000000;
-	shmClock[1] = shmClock[1] % 1000000000;
+// Clears a USER control block in shared memory
+void resetProcessControl ( ProcessControl *control ) {
+	control->blocked = 0;
+	control->pendingRequest = -1;
+	control->replyResource = -1;
+	control->replyTime[0] = 0;
+	control->replyTime[1] = 0;
 }
 
 // Function to terminate all shared memory and message queue up completion or to work with signal handling
 void terminateIPC() {
-	// Close the file
+	// Close the file (waits for the background writer to finish)
 	fclose ( fp );
 	
-	// Detach from shared memory
-	shmdt ( shmClock );
-	shmdt ( shmBlocked );
-
-	// Destroy shared memory
-	shmctl ( shmClockID, IPC_RMID, NULL );
-	shmctl ( shmBlockedID, IPC_RMID, NULL );
+	closeCheckpointFile();
+	
+	// Detach from and destroy the shared memory region
+	shmdt ( shmRegion );
+	shmctl ( shmRegionID, IPC_RMID, NULL );
 	
 	// Destroy message queue
 	msgctl ( messageID, IPC_RMID, NULL );
 }
 
-// Function to create a queue of given capacity.
-// It initializes size of queue as 0.
-Queue* createQueue ( unsigned capacity ) {
-	Queue* queue = (Queue*) malloc ( sizeof ( Queue ) );
-	queue->capacity = capacity;
-	queue->front = queue->size = 0;
-	queue->rear = capacity - 1;	// This is important, see the enqueue
-	queue->array = (int*) malloc ( queue->capacity * sizeof ( int ) );
-
-	return queue;
-}
-
-// Queue is full when size becomes equal to the capacity
-int isFull ( Queue* queue ) {
-	return ( queue->size == queue->capacity );
-}
-
-// Queue is empty when size is 0
-int isEmpty ( Queue* queue ) { 
-	return ( queue->size == 0 );
-}
-
-// Function to add an item to the queue.
-// It changes rear and size.
-void enqueue ( Queue* queue, int item ) {
-	if ( isFull ( queue ) ) 
-		return;
+// Returns true if an IPC object looks like one an OSS run left behind: keyed by ipcKey(), owned
+//   by this user, and made or last used by a process that no longer exists. The key's embedded pid
+//   alone isn't enough, since other programs' keys can share the tag and an OSS in another pid
+//   namespace sharing this IPC namespace has pids that mean nothing here. A pid from another
+//   namespace reads as 0, which is never treated as gone.
+// creatorPid equal to this OSS's pid can only come from an earlier run with the same pid, since
+//   this one hasn't created anything yet.
+bool isStaleObject ( struct ipc_perm *perm, pid_t creatorPid ) {
+	if ( ( ( perm->__key >> 24 ) & 0xFF ) != ipcKeyTag || perm->uid != getuid() || creatorPid <= 0 )
+		return false;
+	if ( creatorPid == getpid() )
+		return true;
 	
-	queue->rear = ( queue->rear + 1 ) % queue->capacity;
-	queue->array[queue->rear] = item;
-	queue->size = queue->size + 1;
+	return processGone ( creatorPid );
 }
 
-// Function to remove an item from queue.
-// It changes front and size.
-int dequeue ( Queue* queue ) {
-	if ( isEmpty ( queue ) )
-		return INT_MIN;
-
-	int item = queue->array[queue->front];
-	queue->front = ( queue->front + 1 ) % queue->capacity;
-	queue->size = queue->size - 1;
-
-	return item;
+// True if a process has exited. A zombie counts as gone: a USER killed along with its OSS can
+//   wait a while to be reaped, but it will never use the objects again.
+bool processGone ( pid_t pid ) {
+	char path[64];
+	char state = 0;
+	FILE *statFp;
+	
+	if ( kill ( pid, 0 ) == -1 )
+		return errno == ESRCH;
+	
+	// The state follows the command name, which is in parentheses and may contain spaces
+	snprintf ( path, sizeof ( path ), "/proc/%d/stat", ( int ) pid );
+	if ( ( statFp = fopen ( path, "r" ) ) == NULL )
+		return false;
+	if ( fscanf ( statFp, "%*d (%*[^)]) %c", &state ) != 1 )
+		state = 0;
+	fclose ( statFp );
+	return state == 'Z';
 }
 
-// Function to get front of queue.
-int front ( Queue* queue ) {
-	if ( isEmpty ( queue ) )
-		return INT_MIN;
-
-	return queue->array[queue->front];
+// True if the shared memory region of the OSS instance that key belongs to still exists and has
+//   something attached. A running OSS keeps its region attached for as long as its queue exists.
+bool regionAttached ( key_t key ) {
+	struct shmid_ds shmInfo;
+	int id;
+	
+	if ( ( id = shmget ( ipcKey ( ( key >> 2 ) & 0x3FFFFF, ipcRegionObject ), 0, 0 ) ) == -1 )
+		return false;
+	return shmctl ( id, IPC_STAT, &shmInfo ) == 0 && shmInfo.shm_nattch > 0;
 }
 
-// Function to get rear of queue.
-int rear ( Queue* queue ) {
-	if ( isEmpty ( queue ) )
-		return INT_MIN;
-
-	return queue->array[queue->rear];
+// Function to remove shared memory segments and message queues left behind by OSS runs that crashed
+//   before they could clean up. A segment must also have nothing attached; a message queue is
+//   judged by its last sender (a queue nothing was ever sent on is left alone), and by its last
+//   receiver if it has one. Both can be USERs that just exited while their OSS runs on, so a queue
+//   is also left alone while its instance's region is attached. Objects of other live OSS
+//   instances are left alone.
+void removeStaleIPC() {
+	struct shmid_ds shmInfo;
+	struct msqid_ds msgInfo;
+	int highestIndex;
+	int i, id;
+	
+	highestIndex = shmctl ( 0, SHM_INFO, ( struct shmid_ds * ) &shmInfo );
+	for ( i = 0; i <= highestIndex; ++i ) {
+		if ( ( id = shmctl ( i, SHM_STAT, &shmInfo ) ) == -1 )
+			continue;
+		if ( shmInfo.shm_nattch == 0 && isStaleObject ( &shmInfo.shm_perm, shmInfo.shm_cpid ) ) {
+			shmctl ( id, IPC_RMID, NULL );
+		}
+	}
+	
+	highestIndex = msgctl ( 0, MSG_INFO, ( struct msqid_ds * ) &msgInfo );
+	for ( i = 0; i <= highestIndex; ++i ) {
+		if ( ( id = msgctl ( i, MSG_STAT, &msgInfo ) ) == -1 )
+			continue;
+		if ( isStaleObject ( &msgInfo.msg_perm, msgInfo.msg_lspid ) &&
+		     ( msgInfo.msg_lrpid == 0 || isStaleObject ( &msgInfo.msg_perm, msgInfo.msg_lrpid ) ) &&
+		     !regionAttached ( msgInfo.msg_perm.__key ) ) {
+			msgctl ( id, IPC_RMID, NULL );
+		}
+	}
 }
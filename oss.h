@@ -23,11 +23,101 @@
 #include <sys/time.h>
 #include <stdbool.h>
 
+#include "sizes.h"
+
 /* Macros */
-#define maxProcesses 100
-#define maxResources 20
+// IPC keys are derived per OSS instance so several simulations can run side by side.
+// Key layout: tag byte | low 22 bits of the OSS pid (the instance ID) | 2 bits naming the object.
+// The pid in the key lets a new OSS recognize objects left behind by a run that crashed.
+#define ipcKeyTag 0x4F
+#define ipcRegionObject 0
+#define ipcMessageObject 1
+#define ipcKey( instance, object ) ( ( key_t ) ( ( ipcKeyTag << 24 ) | ( ( ( instance ) & 0x3FFFFF ) << 2 ) | ( object ) ) )
+
+// Columns of the CSV row OSS appends to its result file (-o). Shared with sweep, which writes the header.
+#define resultCsvHeader "maxRunning,maxClaim,spawnBound,totalLow,totalHigh,requestPct,releasePct,terminatePct,kernel,seed," \
+	"processesCreated,processesTerminated,events,simSeconds,wallSeconds,eventsPerSecond,requests,granted,grantRate," \
+	"safetyChecks,latencyP50,latencyP90,latencyP99,latencyMax,workload"
+
+// Shared memory layout. Everything OSS and USER share lives in one segment (SharedRegion below).
+// Each part sits on its own cache line: OSS writes the clock on every event and USERs poll their
+//   own control block, so nothing a USER reads shares a line with what another USER or the clock writes.
+#define cacheLineSize 64
+#define sharedRegionMagic 0x4F535352	// "OSSR"
+#define sharedRegionVersion 4		// Bump whenever SharedRegion changes
+
+// Allocation table snapshots in the logfile. Each snapshot lists only the rows of the allocated
+//   resources table that changed since the previous one, nonzero cells only:
+//       Allocation snapshot at 0:127465000 (2 changed rows)
+//       	P3: R1=1 R7=2
+//       	P5: -			(row is back to all zeros)
+// Each segment of a segmented log (see logstream.c) starts with a full snapshot, "(N rows, full)",
+//   which also lists every nonzero row, so the table can still be rebuilt after older segments are deleted.
+// The rebuild tool replays them to recover the whole table at any simulated time.
+#define snapshotHeader "Allocation snapshot at"
 
 /* Structure(s) */
+// First line of the region. USER checks it before using anything else, so a USER built with
+//   different table sizes (or an older layout) fails at startup instead of reading the wrong slots.
+typedef struct {
+	unsigned int magic;		// sharedRegionMagic
+	unsigned int version;		// sharedRegionVersion
+	unsigned int regionSize;	// sizeof ( SharedRegion ) as built into OSS
+	unsigned int processSlots;	// maxProcesses as built into OSS
+	unsigned int resourceTypes;	// maxResources as built into OSS
+	unsigned int profiling;		// 1 if USERs time their request path, 0 with OSS's -P (see profile.c)
+} __attribute__ ( ( aligned ( cacheLineSize ) ) ) SharedHeader;
+
+// Simulated clock, written only by OSS
+typedef struct {
+	unsigned int time[2];		// Seconds, nanoseconds
+} __attribute__ ( ( aligned ( cacheLineSize ) ) ) SharedClock;
+
+// How a USER behaves beyond its request/release/terminate percentages. OSS fills it in from the
+//   workload profile (-W, see workload.c) before spawning a USER; USER copies it at startup.
+typedef struct {
+	int classIndex;			// Client class in the profile, 0 without one
+	float zipfExponent;		// Popularity skew of resources (resource 0 hottest), 0 for uniform
+	int burstChance;		// Percent chance on each action of starting a burst of requests
+	int burstLength;		// Requests in a burst
+	unsigned int holdTime;		// Simulated ns a granted resource is held before it may be released
+	unsigned int thinkTime;		// Simulated ns between actions
+} Workload;
+
+// One USER's control block. The slot is reset by OSS when a USER is spawned into it.
+typedef struct {
+	Workload workload;		// Written by OSS before the USER is spawned
+	int blocked;			// 1 while the USER's request sits in OSS's blocked queue
+	int pendingRequest;		// Resource the USER is waiting on, -1 if none (written by USER)
+	int replyResource;		// Last resource OSS granted this USER, -1 if none (written by OSS)
+	unsigned int replyTime[2];	// Simulated time of that grant
+} __attribute__ ( ( aligned ( cacheLineSize ) ) ) ProcessControl;
+
+// Parts of a USER's request path that it times (see profile.c)
+typedef enum {
+	userPhaseDecide,	// From deciding to act to a request being ready to send
+	userPhaseSend,		// Sending the request to OSS
+	userPhasePoll,		// Checking for OSS's reply while a request is outstanding
+	userPhaseWait,		// A request from being sent to its grant arriving (a round trip, overlapping the others)
+	userPhaseCount
+} UserPhase;
+
+// One USER's time (real ns) and calls in each phase. Written only by that USER; OSS adds them up for its report.
+typedef struct {
+	long long ns[userPhaseCount];
+	long long calls[userPhaseCount];
+} __attribute__ ( ( aligned ( cacheLineSize ) ) ) UserProfile;
+
+typedef struct {
+	SharedHeader header;
+	SharedClock clock;
+	ProcessControl process[maxProcesses];
+	UserProfile profile[maxProcesses];
+} SharedRegion;
+
+_Static_assert ( sizeof ( ProcessControl ) == cacheLineSize, "ProcessControl must fill exactly one cache line" );
+_Static_assert ( sizeof ( UserProfile ) == cacheLineSize, "UserProfile must fill exactly one cache line" );
+
 // Structure used in the message queue 
 typedef struct {
 	long msg_type;		// Controls who can receive the message.
@@ -44,17 +134,15 @@ typedef struct {
 void handle ( int sig_num );	// Function to handle the alarm or ctrl-c signals
 
 /* Message Queue Variables */
-Message message;
-int messageID;
-key_t messageKey;
+// Defined once in oss.c and user.c so other modules can include this header
+extern Message message;
+extern int messageID;
+extern key_t messageKey;
 
 /* Shared Memory Variables */
-int shmClockID;
-int *shmClock;
-key_t shmClockKey;
-
-int shmBlockedID;
-int *shmBlocked;
-key_t shmBlockedKey;
+extern int shmRegionID;
+extern SharedRegion *shmRegion;
+extern key_t shmRegionKey;
+extern unsigned int *shmClock;	// Points at shmRegion->clock.time
 
 #endif 
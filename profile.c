@@ -0,0 +1,255 @@
+// File: profile.c | Linked into: oss, user
+//
+// Time profile of OSS's main loop, and of the request path of every USER.
+// OSS marks where each section of its loop starts and ends (profileEnter() / profileLeave()); the time
+// between two marks goes to the phase on top, so nested phases (a log line written while spawning)
+// count only once. A mark reads only the monotonic clock. Real time alone blames whatever phase is
+// open when OSS is preempted (on a busy machine the USERs polling for replies take most of the
+// CPU), so the causes are ranked by CPU time. The CPU clock is a system call, so it is read once
+// every cpuSampleInterval loop passes, and the CPU time in between is split across the phases by
+// their real time in that stretch.
+// USERs keep their own real time totals in their UserProfile in shared memory, and OSS adds them
+// up when it reports. profileDisable() (OSS's -P) turns all of it off.
+
+#define _GNU_SOURCE	// RUSAGE_THREAD
+#include <sys/resource.h>
+
+#include "profile.h"
+
+#define cpuSampleInterval 32	// Loop passes between reads of the CPU clock
+
+// Reported together as one cause in the summary line
+typedef enum {
+	groupIpc,
+	groupBanker,
+	groupLog,
+	groupProcesses,
+	groupIdle,
+	groupOther,
+	groupCount
+} ProfileGroup;
+
+static const char *phaseNames[phaseCount] = { "loop", "reap", "spawn", "receive", "idle poll", "banker", "reply", "log",
+					      "snapshot", "checkpoint" };
+static const ProfileGroup phaseGroups[phaseCount] = { groupOther, groupProcesses, groupProcesses, groupIpc, groupIdle,
+						      groupBanker, groupIpc, groupLog, groupLog, groupOther };
+static const char *groupNames[groupCount] = { "IPC", "banker's check", "log I/O", "process creation", "idle", "other" };
+static const char *userPhaseNames[userPhaseCount] = { "decide", "send", "poll", "round trip" };
+
+static long long phaseNs[phaseCount];		// Real time
+static long long phaseCpuNs[phaseCount];	// CPU time of OSS's main thread, split by sampleCpu()
+static long long sampleNs[phaseCount];		// Real time since the CPU clock was last read
+static long long longestNs = 0;			// Longest time between two marks since then
+static ProfilePhase longestPhase;		//   and the phase it went to
+static long long phaseCalls[phaseCount];
+static ProfilePhase phaseStack[maxProfileDepth];
+static int depth = 0;			// Phases entered and not yet left; phaseLoop is underneath them all
+static long long mark;			// When the time since was last handed to a phase
+static long long cpuMark;		// The main thread's CPU time when the CPU clock was last read
+static int passesSinceSample = 0;
+static long involuntaryStart;		// Times the main thread had been preempted when the profile started
+static bool enabled = true;
+static bool running = false;
+
+static long long readClock ( clockid_t clock );
+static long involuntarySwitches ();
+static void chargeTo ( ProfilePhase phase );
+static void sampleCpu ();
+
+// Real time in nanoseconds, or 0 once profiling is disabled
+long long profileClock () {
+	return enabled ? readClock ( CLOCK_MONOTONIC ) : 0;
+}
+
+// Turns every mark, clock read and report into a no-op. Called before profileStart().
+void profileDisable () {
+	enabled = false;
+}
+
+// Starts the profile. Marks made before this (while OSS sets up) are ignored.
+void profileStart () {
+	if ( !enabled )
+		return;
+	cpuMark = readClock ( CLOCK_THREAD_CPUTIME_ID );
+	involuntaryStart = involuntarySwitches();
+	mark = profileClock();
+	depth = 0;
+	running = true;
+}
+
+// The loop is going into a phase
+void profileEnter ( ProfilePhase phase ) {
+	if ( !running )
+		return;
+	chargeTo ( depth > 0 ? phaseStack[depth - 1] : phaseLoop );
+	if ( depth < maxProfileDepth )
+		phaseStack[depth++] = phase;
+	phaseCalls[phase]++;
+}
+
+// The loop is done with the phase it entered last
+void profileLeave () {
+	if ( !running || depth == 0 )
+		return;
+	chargeTo ( phaseStack[--depth] );
+}
+
+// Like profileLeave(), but the time and the call go to another phase, for sections whose outcome
+//   decides what they were (a poll of the message queue that finds nothing is idle time)
+void profileLeaveAs ( ProfilePhase phase ) {
+	if ( !running || depth == 0 )
+		return;
+	phaseCalls[phaseStack[--depth]]--;
+	phaseCalls[phase]++;
+	chargeTo ( phase );
+}
+
+// Counts one pass through the main loop, and reads the CPU clock every cpuSampleInterval passes
+void profileLoopPass () {
+	if ( !running )
+		return;
+	phaseCalls[phaseLoop]++;
+	if ( ++passesSinceSample == cpuSampleInterval )
+		sampleCpu();
+}
+
+// Prints where the main loop's time went and the USERs' request path totals. The CPU time of
+//   the log's background writer is passed in (-1 if unknown), since it is not in any phase.
+void printProfile ( FILE *out, long long writerCpuNs ) {
+	long long groupCpuNs[groupCount] = { 0 };
+	long long userNs[userPhaseCount] = { 0 };
+	long long userCalls[userPhaseCount] = { 0 };
+	bool reported[groupCount] = { false };
+	long long wallNs = 0, cpuNs = 0;
+	int i, j;
+
+	if ( !running )
+		return;
+
+	// Hand the time so far to the phase the loop is in, so a report mid-run is up to date
+	chargeTo ( depth > 0 ? phaseStack[depth - 1] : phaseLoop );
+	sampleCpu();
+	for ( i = 0; i < phaseCount; ++i ) {
+		wallNs += phaseNs[i];
+		cpuNs += phaseCpuNs[i];
+		groupCpuNs[phaseGroups[i]] += phaseCpuNs[i];
+	}
+	if ( wallNs == 0 )
+		wallNs = 1;
+	if ( cpuNs == 0 )
+		cpuNs = 1;
+
+	fprintf ( out, "Time Profile\n" );
+	fprintf ( out, "\tMain loop: %.3f s real, %.3f s CPU", wallNs / 1e9, cpuNs / 1e9 );
+	if ( writerCpuNs >= 0 )
+		fprintf ( out, " (log writer thread %.3f s CPU)", writerCpuNs / 1e9 );
+	fprintf ( out, ", %lld passes\n", phaseCalls[phaseLoop] );
+	fprintf ( out, "\tOff the CPU: %.3f s, preempted %ld times\n", ( wallNs - cpuNs ) / 1e9,
+		 involuntarySwitches() - involuntaryStart );
+	fprintf ( out, "\tCPU time is read every %d passes and split across the phases by their real time\n", cpuSampleInterval );
+	fprintf ( out, "\tPhase\t\tCalls\t\tReal(ms)\tCPU(ms)\t\tCPU share\tCPU avg(us)\n" );
+	for ( i = 0; i < phaseCount; ++i ) {
+		fprintf ( out, "\t%-10s\t%-10lld\t%.3f\t\t%.3f\t\t%.1f%%\t\t%.3f\n", phaseNames[i], phaseCalls[i], phaseNs[i] / 1e6,
+			 phaseCpuNs[i] / 1e6, 100.0 * phaseCpuNs[i] / cpuNs, phaseCalls[i] > 0 ? phaseCpuNs[i] / 1e3 / phaseCalls[i] : 0.0 );
+	}
+
+	// Causes by CPU time, largest first
+	fprintf ( out, "\tCPU time by cause:" );
+	for ( i = 0; i < groupCount; ++i ) {
+		int largest = -1;
+
+		for ( j = 0; j < groupCount; ++j ) {
+			if ( !reported[j] && ( largest == -1 || groupCpuNs[j] > groupCpuNs[largest] ) )
+				largest = j;
+		}
+		reported[largest] = true;
+		fprintf ( out, "%s %s %.1f%%", i == 0 ? "" : ",", groupNames[largest], 100.0 * groupCpuNs[largest] / cpuNs );
+	}
+	fprintf ( out, "\n" );
+
+	// Every USER this run, live or finished
+	for ( i = 0; i < maxProcesses; ++i ) {
+		for ( j = 0; j < userPhaseCount; ++j ) {
+			userNs[j] += shmRegion->profile[i].ns[j];
+			userCalls[j] += shmRegion->profile[i].calls[j];
+		}
+	}
+	fprintf ( out, "\tUSER request path (all USERs, real time)\n" );
+	fprintf ( out, "\tPhase\t\tCalls\t\tTime(ms)\tAvg(us)\n" );
+	for ( j = 0; j < userPhaseCount; ++j ) {
+		fprintf ( out, "\t%-10s\t%-10lld\t%.3f\t\t%.3f\n", userPhaseNames[j], userCalls[j], userNs[j] / 1e6,
+			 userCalls[j] > 0 ? userNs[j] / 1e3 / userCalls[j] : 0.0 );
+	}
+}
+
+// Adds the time since start to one of a USER's phases and returns the time now, so the next
+//   phase can start from it
+long long userProfileAdd ( UserProfile *profile, UserPhase phase, long long start ) {
+	long long now;
+
+	if ( !enabled )
+		return 0;
+	now = profileClock();
+	profile->ns[phase] += now - start;
+	profile->calls[phase]++;
+	return now;
+}
+
+static long long readClock ( clockid_t clock ) {
+	struct timespec now;
+
+	clock_gettime ( clock, &now );
+	return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// Gives the real time since the last mark to a phase
+static void chargeTo ( ProfilePhase phase ) {
+	long long now = profileClock();
+
+	phaseNs[phase] += now - mark;
+	sampleNs[phase] += now - mark;
+	if ( now - mark > longestNs ) {
+		longestNs = now - mark;
+		longestPhase = phase;
+	}
+	mark = now;
+}
+
+// Splits the CPU time since the CPU clock was last read across the phases, in proportion to their
+//   real time since then. Time off the CPU is taken out of the longest stretch between two marks
+//   first, since that is almost always where OSS was preempted (or slept).
+static void sampleCpu () {
+	long long cpuNow = readClock ( CLOCK_THREAD_CPUTIME_ID );
+	long long spentNs = cpuNow - cpuMark;
+	long long realNs = 0, offNs;
+	int i;
+
+	for ( i = 0; i < phaseCount; ++i ) {
+		realNs += sampleNs[i];
+	}
+	offNs = realNs - spentNs;
+	if ( offNs > 0 ) {
+		if ( offNs > longestNs )
+			offNs = longestNs;
+		sampleNs[longestPhase] -= offNs;
+		realNs -= offNs;
+	}
+	for ( i = 0; i < phaseCount && realNs > 0; ++i ) {
+		phaseCpuNs[i] += ( long long ) ( ( double ) spentNs * sampleNs[i] / realNs );
+	}
+	if ( realNs == 0 )
+		phaseCpuNs[phaseLoop] += spentNs;
+	memset ( sampleNs, 0, sizeof ( sampleNs ) );
+	longestNs = 0;
+	cpuMark = cpuNow;
+	passesSinceSample = 0;
+}
+
+// Times the calling thread was switched out while it could still run
+static long involuntarySwitches () {
+	struct rusage usage;
+
+	if ( getrusage ( RUSAGE_THREAD, &usage ) == -1 )
+		return 0;
+	return usage.ru_nivcsw;
+}
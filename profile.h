@@ -0,0 +1,41 @@
+
+// File: profile.h
+//
+// Header file for the time profile of OSS's main loop and USER's request path (see profile.c)
+
+#ifndef PROFILE_HEADER_FILE
+#define PROFILE_HEADER_FILE
+
+#include <stdbool.h>
+
+#include "oss.h"
+
+#define maxProfileDepth 8	// Phases that can be nested inside each other
+
+// Sections of OSS's main loop. Time in a nested phase counts only towards that phase.
+typedef enum {
+	phaseLoop,		// Everything not in another phase: run limits, clock, live statistics
+	phaseReap,		// Collecting USERs that exited
+	phaseSpawn,		// Creating USERs (fork and exec)
+	phaseReceive,		// Taking a message off the queue
+	phaseIdle,		// Polling the queue and finding nothing
+	phaseBanker,		// Resource manager calls: the safety check and table updates (see resmgr.c)
+	phaseReply,		// Sending grants back to USERs
+	phaseLog,		// Writing log lines, including any wait for the background writer
+	phaseSnapshot,		// Allocation table snapshots in the log
+	phaseCheckpoint,	// Copying the state into the checkpoint file
+	phaseCount
+} ProfilePhase;
+
+/* Function Prototypes */
+long long profileClock ();
+void profileDisable ();
+void profileStart ();
+void profileEnter ( ProfilePhase phase );
+void profileLeave ();
+void profileLeaveAs ( ProfilePhase phase );
+void profileLoopPass ();
+void printProfile ( FILE *out, long long writerCpuNs );
+long long userProfileAdd ( UserProfile *profile, UserPhase phase, long long start );
+
+#endif
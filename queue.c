@@ -0,0 +1,141 @@
+// File: queue.c | Linked into: libresmgr.a (oss, bench)
+//
+// Array queue for OSS's blocked processes, split out of oss.c so the benchmarks can drive it too.
+
+#include <stdlib.h>
+#include <limits.h>
+
+#include "queue.h"
+
+static Queue queuePool[queuePoolSize];
+static int poolSlotUsed[queuePoolSize];
+
+// Function to create a queue of given capacity.
+// It initializes size of queue as 0.
+// Returns NULL if the queue or its array can't be allocated.
+Queue* createQueue ( unsigned capacity ) {
+	Queue* queue = NULL;
+	int i;
+	
+	for ( i = 0; i < queuePoolSize && queue == NULL; ++i ) {
+		if ( !poolSlotUsed[i] ) {
+			poolSlotUsed[i] = 1;
+			queue = &queuePool[i];
+		}
+	}
+	if ( queue == NULL && ( queue = (Queue*) malloc ( sizeof ( Queue ) ) ) == NULL )
+		return NULL;
+	if ( capacity < 1 )
+		capacity = 1;
+	queue->capacity = capacity;
+	queue->front = queue->size = 0;
+	queue->rear = capacity - 1;	// This is important, see the enqueue
+	if ( ( queue->array = (int*) malloc ( queue->capacity * sizeof ( int ) ) ) == NULL ) {
+		destroyQueue ( queue );
+		return NULL;
+	}
+
+	return queue;
+}
+
+// Frees a queue from createQueue() and its array
+void destroyQueue ( Queue* queue ) {
+	if ( queue == NULL )
+		return;
+	free ( queue->array );
+	if ( queue >= queuePool && queue < queuePool + queuePoolSize )
+		poolSlotUsed[queue - queuePool] = 0;
+	else
+		free ( queue );
+}
+
+// Queue is full when size becomes equal to the capacity
+int isFull ( Queue* queue ) {
+	return ( queue->size == queue->capacity );
+}
+
+// Queue is empty when size is 0
+int isEmpty ( Queue* queue ) { 
+	return ( queue->size == 0 );
+}
+
+// Function to add an item to the queue.
+// It changes rear and size.
+// Returns 0 if the queue was full and couldn't grow, so the item wasn't added.
+int enqueue ( Queue* queue, int item ) {
+	if ( isFull ( queue ) && !growQueue ( queue ) )
+		return 0;
+	
+	queue->rear = ( queue->rear + 1 ) % queue->capacity;
+	queue->array[queue->rear] = item;
+	queue->size = queue->size + 1;
+	return 1;
+}
+
+// Doubles a full queue's array, moving the items to the front of the new one in queue order.
+// Returns 0, leaving the queue as it was, if the new array can't be allocated.
+int growQueue ( Queue* queue ) {
+	int *array = (int*) malloc ( 2 * queue->capacity * sizeof ( int ) );
+	int i;
+	
+	if ( array == NULL )
+		return 0;
+	for ( i = 0; i < queue->size; ++i ) {
+		array[i] = queue->array[( queue->front + i ) % queue->capacity];
+	}
+	free ( queue->array );
+	
+	queue->array = array;
+	queue->capacity *= 2;
+	queue->front = 0;
+	queue->rear = queue->size - 1;
+	return 1;
+}
+
+// Function to remove an item from queue.
+// It changes front and size.
+int dequeue ( Queue* queue ) {
+	if ( isEmpty ( queue ) )
+		return INT_MIN;
+
+	int item = queue->array[queue->front];
+	queue->front = ( queue->front + 1 ) % queue->capacity;
+	queue->size = queue->size - 1;
+
+	return item;
+}
+
+// Removes every copy of an item, keeping the rest in queue order.
+// Returns how many were removed.
+int removeItem ( Queue* queue, int item ) {
+	int kept = 0, removed = 0;
+	int i, value;
+	
+	for ( i = 0; i < queue->size; ++i ) {
+		value = queue->array[( queue->front + i ) % queue->capacity];
+		if ( value == item )
+			removed++;
+		else
+			queue->array[( queue->front + kept++ ) % queue->capacity] = value;
+	}
+	queue->size = kept;
+	queue->rear = ( queue->front + kept + queue->capacity - 1 ) % queue->capacity;
+	
+	return removed;
+}
+
+// Function to get front of queue.
+int front ( Queue* queue ) {
+	if ( isEmpty ( queue ) )
+		return INT_MIN;
+
+	return queue->array[queue->front];
+}
+
+// Function to get rear of queue.
+int rear ( Queue* queue ) {
+	if ( isEmpty ( queue ) )
+		return INT_MIN;
+
+	return queue->array[queue->rear];
+}
@@ -0,0 +1,34 @@
+
+// File: queue.h
+//
+// Header file for the array queue OSS keeps its blocked processes in (see queue.c)
+
+#ifndef QUEUE_HEADER_FILE
+#define QUEUE_HEADER_FILE
+
+// Queue code is gotten from https://www.geeksforgeeks.org/queue-set-1introduction-and-array-implementation/
+// A structure to represent a queue.
+// Queues come from a small preallocated pool and their arrays double when full, so an enqueue
+//   only allocates when the queue outgrows everything it has held before, and only drops an item
+//   if that allocation fails. destroyQueue() frees the array and gives the pool slot back.
+#define queuePoolSize 4
+typedef struct {
+	int front, rear, size;
+	unsigned capacity;
+	int *array;  
+	int pid;
+} Queue;
+
+/* Function Prototypes */
+Queue* createQueue ( unsigned capacity );
+void destroyQueue ( Queue* queue );
+int isFull ( Queue* queue ); 
+int isEmpty ( Queue* queue );
+int enqueue ( Queue* queue, int item );
+int dequeue ( Queue* queue );
+int front ( Queue* queue );
+int rear ( Queue* queue );
+int growQueue ( Queue* queue );
+int removeItem ( Queue* queue, int item );
+
+#endif
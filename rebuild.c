@@ -0,0 +1,197 @@
+
+// File: rebuild.c | Executable: rebuild
+//
+// Rebuilds OSS's allocated resources table from the snapshots in its logfile (format in oss.h).
+// Usage: ./rebuild [LOGFILE [SEC:NS]]
+// Replays every snapshot up to the given simulated time (the whole log by default) and prints the
+// table as it stood then, in the same layout OSS used for its full table dumps.
+// LOGFILE is the name given to OSS with -l. Segmented and gzipped logs (see logstream.c) are found
+// from it and read in order, starting with the oldest segment still on disk.
+
+#include <zlib.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "oss.h"
+#include "logstream.h"
+
+bool replayLog ( gzFile logFp );
+int findOldestSegment ( const char *logName, bool *compressed );
+
+int allocatedTable[maxProcesses][maxResources];	// Starts all zero, like OSS's
+unsigned long long targetTime = ~0ULL;	// Simulated time to rebuild the table at
+unsigned long long snapshotTime = 0;	// Time of the last snapshot applied
+int snapshotsApplied = 0;
+int highestRow = -1;	// Highest process index seen, so only rows in use are printed
+bool inSnapshot = false;	// True while reading the rows of a snapshot that is being applied (which can
+				//   run on into the next segment)
+
+int main ( int argc, char *argv[] ) {
+	char *logName = "prog.log";
+	unsigned int seconds, nanoseconds;
+	char fileName[PATH_MAX + 16];
+	struct stat info;
+	bool compressed = false;
+	int firstSegment = -1, segment;
+	int filesRead = 0;
+	gzFile logFp;
+	int i, j;
+
+	if ( argc > 1 && strcmp ( argv[1], "-h" ) == 0 ) {
+		printf ( "Usage: %s [LOGFILE [SEC:NS]]\n", argv[0] );
+		printf ( "Rebuilds the allocated resources table from OSS's snapshots up to simulated time SEC:NS\n" );
+		printf ( "(default: the end of the log). LOGFILE defaults to prog.log; its segments and .gz files are\n" );
+		printf ( "found from the name.\n" );
+		return 0;
+	}
+	if ( argc > 1 )
+		logName = argv[1];
+	if ( argc > 2 ) {
+		if ( sscanf ( argv[2], "%u:%u", &seconds, &nanoseconds ) != 2 ) {
+			fprintf ( stderr, "REBUILD: Time must be SEC:NS.\n" );
+			return 1;
+		}
+		targetTime = seconds * 1000000000ULL + nanoseconds;
+	}
+
+	// Oldest segment still on disk, if the log is segmented
+	firstSegment = findOldestSegment ( logName, &compressed );
+
+	if ( firstSegment == -1 ) {
+		// A single file, plain or gzipped (gzopen reads either)
+		logSegmentName ( fileName, sizeof ( fileName ), logName, 0, false, false );
+		if ( stat ( fileName, &info ) == -1 )
+			logSegmentName ( fileName, sizeof ( fileName ), logName, 0, false, true );
+		if ( ( logFp = gzopen ( fileName, "rb" ) ) == NULL ) {
+			perror ( "REBUILD: Failure to open the logfile." );
+			return 1;
+		}
+		replayLog ( logFp );
+		gzclose ( logFp );
+		filesRead = 1;
+	} else {
+		// Segments in order until one is missing or the target time is passed
+		for ( segment = firstSegment; ; ++segment ) {
+			logSegmentName ( fileName, sizeof ( fileName ), logName, segment, true, compressed );
+			if ( ( logFp = gzopen ( fileName, "rb" ) ) == NULL )
+				break;
+			filesRead++;
+			if ( !replayLog ( logFp ) ) {
+				gzclose ( logFp );
+				break;
+			}
+			gzclose ( logFp );
+		}
+		if ( firstSegment > 0 )
+			fprintf ( stderr, "REBUILD: Segments before %d have been deleted; starting from segment %d.\n", firstSegment, firstSegment );
+	}
+
+	printf ( "Currently Allocated Resources at %llu:%llu (%d snapshots applied from %d file%s)\n", snapshotTime / 1000000000ULL,
+		 snapshotTime % 1000000000ULL, snapshotsApplied, filesRead, filesRead == 1 ? "" : "s" );
+	for ( j = 0; j < maxResources; ++j ) {
+		printf ( "\tR%d", j );
+	}
+	printf ( "\n" );
+	for ( i = 0; i <= highestRow; ++i ) {
+		printf ( "P%d:\t", i );
+		for ( j = 0; j < maxResources; ++j ) {
+			printf ( "%d\t", allocatedTable[i][j] );
+		}
+		printf ( "\n" );
+	}
+
+	return 0;
+}
+
+// Lists the log's directory for the lowest numbered segment of logName (NAME.NNNN or NAME.NNNN.gz).
+//   The writer keeps numbering past logSegmentDigits digits, so a long run with old segments deleted
+//   can leave only segments 10000 and up. A plain segment is preferred over a gzipped one with the
+//   same number. Returns the segment number, or -1 if the log isn't segmented.
+int findOldestSegment ( const char *logName, bool *compressed ) {
+	char directoryName[PATH_MAX];
+	const char *baseName = logName;
+	const char *slash = strrchr ( logName, '/' );
+	size_t baseLength;
+	DIR *directory;
+	struct dirent *entry;
+	char *digits, *end;
+	long segment;
+	int oldest = -1;
+
+	if ( slash == NULL ) {
+		snprintf ( directoryName, sizeof ( directoryName ), "." );
+	} else {
+		snprintf ( directoryName, sizeof ( directoryName ), "%.*s", slash == logName ? 1 : ( int ) ( slash - logName ), logName );
+		baseName = slash + 1;
+	}
+	if ( ( directory = opendir ( directoryName ) ) == NULL )
+		return -1;
+
+	baseLength = strlen ( baseName );
+	while ( ( entry = readdir ( directory ) ) != NULL ) {
+		if ( strncmp ( entry->d_name, baseName, baseLength ) != 0 || entry->d_name[baseLength] != '.' )
+			continue;
+		digits = entry->d_name + baseLength + 1;
+		for ( end = digits; isdigit ( ( unsigned char ) *end ); ++end );
+		if ( end - digits < logSegmentDigits || end - digits > 9 || ( strcmp ( end, "" ) != 0 && strcmp ( end, ".gz" ) != 0 ) )
+			continue;
+		segment = strtol ( digits, NULL, 10 );
+		if ( oldest == -1 || segment < oldest || ( segment == oldest && *end == '\0' ) ) {
+			oldest = segment;
+			*compressed = *end != '\0';
+		}
+	}
+	closedir ( directory );
+
+	return oldest;
+}
+
+// Applies the snapshots in one file of the log. Returns false once a snapshot past the target time
+//   is reached, so no later file needs reading.
+bool replayLog ( gzFile logFp ) {
+	unsigned int seconds, nanoseconds;
+	char line[1024];
+	int j;
+
+	while ( gzgets ( logFp, line, sizeof ( line ) ) != NULL ) {
+		// Snapshot header: apply the rows that follow if it is not past the target time
+		if ( strncmp ( line, snapshotHeader, strlen ( snapshotHeader ) ) == 0 ) {
+			if ( sscanf ( line + strlen ( snapshotHeader ), " %u:%u", &seconds, &nanoseconds ) != 2 ) {
+				inSnapshot = false;
+				continue;
+			}
+			if ( seconds * 1000000000ULL + nanoseconds > targetTime )
+				return false;
+			snapshotTime = seconds * 1000000000ULL + nanoseconds;
+			snapshotsApplied++;
+			inSnapshot = true;
+			continue;
+		}
+
+		// Row of the current snapshot: "\tP<index>:" then R<resource>=<amount> for each nonzero cell
+		int row, consumed;
+		if ( inSnapshot && sscanf ( line, "\tP%d:%n", &row, &consumed ) == 1 ) {
+			char *cursor = line + consumed;
+			int resource, amount;
+
+			if ( row < 0 || row >= maxProcesses )
+				continue;
+			for ( j = 0; j < maxResources; ++j ) {
+				allocatedTable[row][j] = 0;
+			}
+			while ( sscanf ( cursor, " R%d=%d%n", &resource, &amount, &consumed ) == 2 ) {
+				if ( resource >= 0 && resource < maxResources )
+					allocatedTable[row][resource] = amount;
+				cursor += consumed;
+			}
+			if ( row > highestRow )
+				highestRow = row;
+			continue;
+		}
+
+		inSnapshot = false;
+	}
+
+	return true;
+}
@@ -0,0 +1,362 @@
+// File: resmgr.c | Linked into: libresmgr.a (oss, bench)
+//
+// OSS's resource manager without the IPC: the tables, the blocked queue and the banker's decisions,
+// behind a ResourceManager context. OSS turns each USER message into one of these calls; anything
+// else that wants the same decisions (another scheduler, a benchmark) can link libresmgr.a and make
+// them directly.
+// Amounts are vectors over the resource types, and every call that changes the tables takes the
+// caller's current time ("now"), which is only used for the statistics.
+// A manager is not thread safe, and the banker's checks share scratch space (see banker.c), so all
+// managers in a program have to be used from one thread at a time.
+
+#include <string.h>
+
+#include "resmgr.h"
+#include "trace.h"
+
+// Tracepoints take the time as seconds and nanoseconds, like OSS's simulated clock
+#define traceSeconds( now ) ( ( unsigned int ) ( ( now ) / 1000000000LL ) )
+#define traceNanoseconds( now ) ( ( unsigned int ) ( ( now ) % 1000000000LL ) )
+
+const int resmgrMaxProcesses = maxProcesses;
+const int resmgrMaxResources = maxResources;
+
+static bool validProcess ( int process );
+static bool checkSafety ( ResourceManager *manager, int process, bool newRequest, long long now );
+static void moveUnits ( ResourceManager *manager, int process, int resource, int amount, long long now );
+static void allocateVector ( ResourceManager *manager, int process, int amounts[], int sign, long long now );
+
+// Sets up a new manager, which can be uninitialized memory: every unit available, no processes.
+// Called through resmgrInit(), which passes the caller's sizeof ( ResourceManager ) and table sizes.
+// Returns false if they don't match the library's, or if the blocked queue can't be allocated.
+bool resmgrInitSized ( ResourceManager *manager, int total[], size_t managerSize, int processes, int resources ) {
+	Queue *blockedQueue;
+
+	if ( managerSize != sizeof ( ResourceManager ) || processes != maxProcesses || resources != maxResources )
+		return false;
+	if ( ( blockedQueue = createQueue ( maxProcesses ) ) == NULL )
+		return false;
+
+	manager->blockedQueue = blockedQueue;
+	resmgrReset ( manager, total );
+	return true;
+}
+
+// Frees what resmgrInit() allocated. The manager can't be used again until it is set up anew.
+void resmgrDestroy ( ResourceManager *manager ) {
+	destroyQueue ( manager->blockedQueue );
+	manager->blockedQueue = NULL;
+}
+
+// Starts a manager set up by resmgrInit() over with new totals. The blocked queue is emptied and
+//   kept, so starting over doesn't allocate.
+void resmgrReset ( ResourceManager *manager, int total[] ) {
+	Queue *blockedQueue = manager->blockedQueue;
+	int i;
+
+	memset ( manager, 0, sizeof ( ResourceManager ) );
+	blockedQueue->front = blockedQueue->size = 0;
+	blockedQueue->rear = blockedQueue->capacity - 1;
+	manager->blockedQueue = blockedQueue;
+
+	memcpy ( manager->total, total, sizeof ( manager->total ) );
+	memcpy ( manager->available, total, sizeof ( manager->available ) );
+	manager->kernel = isSafeStateGeneric;
+	for ( i = 0; i < maxResources; ++i ) {
+		manager->resourceStats[i].resource = i;
+		manager->resourceStats[i].zeroSince = manager->available[i] <= 0 ? 0 : -1;
+	}
+}
+
+// Picks the banker's check by name: auto (whatever fits the table best), sparse, queued, dense or
+//   generic. Cells never hold more than the largest resource total or largestClaim, so that bounds
+//   the cell type a dense kernel can use. Returns false for an unknown name.
+bool resmgrSelectKernel ( ResourceManager *manager, const char *choice, int largestClaim ) {
+	int largestCellValue = largestClaim;
+	int i;
+
+	for ( i = 0; i < maxResources; ++i ) {
+		if ( manager->total[i] > largestCellValue )
+			largestCellValue = manager->total[i];
+	}
+	if ( strcmp ( choice, "generic" ) == 0 )
+		manager->kernel = isSafeStateGeneric;
+	else if ( strcmp ( choice, "dense" ) == 0 )
+		manager->kernel = selectDenseSafetyKernel ( maxResources, largestCellValue );
+	else if ( strcmp ( choice, "sparse" ) == 0 )
+		manager->kernel = isSafeStateSparse;
+	else if ( strcmp ( choice, "queued" ) == 0 )
+		manager->kernel = isSafeStateQueued;
+	else if ( strcmp ( choice, "auto" ) == 0 )
+		manager->kernel = selectSafetyKernel ( maxResources, largestCellValue );
+	else
+		return false;
+
+	// The sparse check works from per-process bitmasks that have to be kept in step with the tables
+	resmgrSync ( manager, 0 );
+	return true;
+}
+
+// Brings what the manager derives from its tables (the sparse masks and when each resource ran out)
+//   back in step after the tables were written directly, e.g. from a checkpoint. A resource that is
+//   out counts as out since now.
+void resmgrSync ( ResourceManager *manager, long long now ) {
+	int i;
+
+	for ( i = 0; i < maxResources; ++i ) {
+		if ( manager->available[i] > 0 )
+			manager->resourceStats[i].zeroSince = -1;
+		else if ( manager->resourceStats[i].zeroSince < 0 )
+			manager->resourceStats[i].zeroSince = now;
+	}
+
+	sparseNeedUse ( &manager->sparse );
+	manager->sparse.enabled = false;
+	if ( manager->kernel == isSafeStateSparse )
+		sparseNeedRebuild ( manager->maximum, manager->allot, manager->available );
+}
+
+// Starts a process in an unused slot with its max claim for each resource. A claim can never exceed
+//   the resource's total, or the process could never finish and every state would look unsafe, so
+//   claims are capped at the totals (the caller can read the capped claims back from maximum).
+bool resmgrRegisterProcess ( ResourceManager *manager, int process, int claims[] ) {
+	int i;
+
+	if ( !validProcess ( process ) || manager->live[process] || manager->blocked[process] )
+		return false;
+
+	sparseNeedUse ( &manager->sparse );
+	for ( i = 0; i < maxResources; ++i ) {
+		manager->maximum[process][i] = claims[i] < 0 ? 0 : claims[i];
+		if ( manager->maximum[process][i] > manager->total[i] )
+			manager->maximum[process][i] = manager->total[i];
+		sparseNeedCellChanged ( process, i, manager->maximum, manager->allot, manager->available );
+	}
+	// Nothing of the slot's last process carries over to the new one
+	memset ( manager->request[process], 0, sizeof ( manager->request[process] ) );
+	manager->requestTime[process] = 0;
+	manager->live[process] = true;
+	return true;
+}
+
+// A process asks for amounts of each resource. The units are handed out if the state stays safe;
+//   otherwise nothing changes and the request waits in the blocked queue (see resmgrRetryBlocked()).
+// A process that is already blocked can't make another request.
+ResmgrResult resmgrRequest ( ResourceManager *manager, int process, int amounts[], long long now ) {
+	int i;
+
+	if ( !validProcess ( process ) || !manager->live[process] || manager->blocked[process] )
+		return resmgrInvalid;
+	for ( i = 0; i < maxResources; ++i ) {
+		if ( amounts[i] < 0 || manager->allot[process][i] + amounts[i] > manager->maximum[process][i] )
+			return resmgrInvalid;
+	}
+
+	manager->requests++;
+	memcpy ( manager->request[process], amounts, sizeof ( manager->request[process] ) );
+	manager->requestTime[process] = now;
+	for ( i = 0; i < maxResources; ++i ) {
+		if ( amounts[i] > 0 )
+			manager->resourceStats[i].requests++;
+	}
+
+	// Temporarily change the tables to test the state, and put them back if it is unsafe
+	allocateVector ( manager, process, amounts, 1, now );
+	if ( checkSafety ( manager, process, true, now ) ) {
+		manager->grants++;
+		for ( i = 0; i < maxResources; ++i ) {
+			if ( amounts[i] > 0 )
+				manager->resourceStats[i].grants++;
+		}
+		return resmgrGranted;
+	}
+
+	allocateVector ( manager, process, amounts, -1, now );
+	enqueue ( manager->blockedQueue, process );
+	manager->blocked[process] = true;
+	for ( i = 0; i < maxResources; ++i ) {
+		if ( amounts[i] > 0 )
+			manager->resourceStats[i].blocks++;
+	}
+	return resmgrBlocked;
+}
+
+// Retries the oldest blocked request, setting process to whose it was. Granted, or blocked again at
+//   the back of the queue. A retry is not counted as a new request.
+ResmgrResult resmgrRetryBlocked ( ResourceManager *manager, long long now, int *process ) {
+	int *amounts;
+	int p, i;
+
+	if ( isEmpty ( manager->blockedQueue ) )
+		return resmgrNothingBlocked;
+
+	p = dequeue ( manager->blockedQueue );
+	*process = p;
+
+	amounts = manager->request[p];
+	allocateVector ( manager, p, amounts, 1, now );
+	if ( checkSafety ( manager, p, false, now ) ) {
+		long long wait = now - manager->requestTime[p];
+
+		manager->grants++;
+		manager->blocked[p] = false;
+
+		// How long this blocked request waited counts against each resource it wanted
+		for ( i = 0; i < maxResources; ++i ) {
+			if ( amounts[i] <= 0 )
+				continue;
+			manager->resourceStats[i].grants++;
+			manager->resourceStats[i].waitedGrants++;
+			manager->resourceStats[i].totalWait += wait;
+			if ( wait > manager->resourceStats[i].maxWait )
+				manager->resourceStats[i].maxWait = wait;
+		}
+		return resmgrGranted;
+	}
+
+	allocateVector ( manager, p, amounts, -1, now );
+	enqueue ( manager->blockedQueue, p );
+	return resmgrBlocked;
+}
+
+// A process gives back amounts of each resource. Returns false, changing nothing, if it doesn't hold them.
+bool resmgrRelease ( ResourceManager *manager, int process, int amounts[], long long now ) {
+	int i;
+
+	if ( !validProcess ( process ) || !manager->live[process] )
+		return false;
+	for ( i = 0; i < maxResources; ++i ) {
+		if ( amounts[i] < 0 || amounts[i] > manager->allot[process][i] )
+			return false;
+	}
+
+	manager->releases++;
+	allocateVector ( manager, process, amounts, -1, now );
+	return true;
+}
+
+// A process finishes. Everything it held is returned and its claim cleared, so it no longer counts
+//   against the safety check. If it was blocked its request is taken out of the blocked queue.
+bool resmgrTerminate ( ResourceManager *manager, int process, long long now ) {
+	int i;
+
+	if ( !validProcess ( process ) || !manager->live[process] )
+		return false;
+
+	sparseNeedUse ( &manager->sparse );
+	for ( i = 0; i < maxResources; ++i ) {
+		manager->maximum[process][i] = 0;
+		moveUnits ( manager, process, i, -manager->allot[process][i], now );
+	}
+	if ( manager->blocked[process] ) {
+		removeItem ( manager->blockedQueue, process );
+		manager->blocked[process] = false;
+	}
+	manager->live[process] = false;
+	manager->terminations++;
+	return true;
+}
+
+// True if the tables as they stand are safe. Not counted in the statistics.
+bool resmgrIsSafe ( ResourceManager *manager ) {
+	sparseNeedUse ( &manager->sparse );
+	return manager->kernel ( manager->available, manager->maximum, manager->allot );
+}
+
+bool resmgrIsBlocked ( ResourceManager *manager, int process ) {
+	return validProcess ( process ) && manager->blocked[process];
+}
+
+int resmgrBlockedCount ( ResourceManager *manager ) {
+	return manager->blockedQueue->size;
+}
+
+// First resource in a process's last request, -1 if it has never asked for anything
+int resmgrRequestedResource ( ResourceManager *manager, int process ) {
+	int i;
+
+	if ( !validProcess ( process ) )
+		return -1;
+	for ( i = 0; i < maxResources; ++i ) {
+		if ( manager->request[process][i] > 0 )
+			return i;
+	}
+	return -1;
+}
+
+static bool validProcess ( int process ) {
+	return process >= 0 && process < maxProcesses;
+}
+
+// Runs the banker's check on the tables with the request being decided already in them.
+// process is the requester, for the tracepoints. newRequest is false for a retry from the blocked
+//   queue, whose blockers were already counted when it was first blocked.
+static bool checkSafety ( ResourceManager *manager, int process, bool newRequest, long long now ) {
+	bool blockers[maxResources];
+	bool safe;
+	int i;
+
+	manager->safetyChecks++;
+	OSS_TRACE ( safety_start, process, resmgrRequestedResource ( manager, process ), traceSeconds ( now ), traceNanoseconds ( now ) );
+	safe = manager->kernel ( manager->available, manager->maximum, manager->allot );
+	OSS_TRACE_SAFETY_END ( process, resmgrRequestedResource ( manager, process ), traceSeconds ( now ), traceNanoseconds ( now ),
+			       safe, safetyCheckPasses );
+
+	// Note which resources the stuck processes were short of, from where the check stopped
+	if ( !safe && newRequest ) {
+		lastCheckBlockers ( manager->maximum, manager->allot, blockers );
+		for ( i = 0; i < maxResources; ++i ) {
+			if ( blockers[i] )
+				manager->resourceStats[i].safetyFailures++;
+		}
+	}
+
+	// Differential check: every decision must match the textbook algorithm, and so must the
+	//   resources blamed for an unsafe one
+	if ( manager->verify ) {
+		bool expected[maxResources];
+
+		if ( manager->kernel != isSafeStateGeneric &&
+		     isSafeStateGeneric ( manager->available, manager->maximum, manager->allot ) != safe )
+			manager->mismatches++;
+		else if ( !safe && newRequest ) {
+			findSafetyBlockers ( manager->available, manager->maximum, manager->allot, expected );
+			if ( memcmp ( blockers, expected, sizeof ( expected ) ) != 0 )
+				manager->mismatches++;
+		}
+	}
+
+	return safe;
+}
+
+// Moves amount units of a resource from the available pool into a process's allocation (a negative
+//   amount gives them back) and keeps the sparse masks and the exhausted time in step with the tables.
+// The caller has picked the manager's masks with sparseNeedUse().
+static void moveUnits ( ResourceManager *manager, int process, int resource, int amount, long long now ) {
+	ResourceStats *stats = &manager->resourceStats[resource];
+
+	manager->allot[process][resource] += amount;
+	manager->available[resource] -= amount;
+	manager->dirtyRows[process] = true;
+
+	// Track how long the resource spends exhausted
+	if ( manager->available[resource] <= 0 && stats->zeroSince < 0 ) {
+		stats->zeroSince = now;
+	} else if ( manager->available[resource] > 0 && stats->zeroSince >= 0 ) {
+		stats->zeroAvailableTime += now - stats->zeroSince;
+		stats->zeroSince = -1;
+	}
+	sparseNeedCellChanged ( process, resource, manager->maximum, manager->allot, manager->available );
+	sparseNeedAvailableChanged ( resource, manager->maximum, manager->allot, manager->available );
+}
+
+// Adds (sign 1) or takes back (sign -1) a vector of amounts
+static void allocateVector ( ResourceManager *manager, int process, int amounts[], int sign, long long now ) {
+	int i;
+
+	sparseNeedUse ( &manager->sparse );
+	for ( i = 0; i < maxResources; ++i ) {
+		if ( amounts[i] != 0 )
+			moveUnits ( manager, process, i, sign * amounts[i], now );
+	}
+}
@@ -0,0 +1,95 @@
+
+// File: resmgr.h
+//
+// Header file for the resource manager library, libresmgr.a (see resmgr.c)
+// Only needs the table sizes (sizes.h), not OSS's IPC layer. A program linking the library has to
+//   be built with the same maxProcesses and maxResources; resmgrInit() refuses a manager of another layout.
+// A manager is not thread safe, and the banker's checks share scratch space and the sparse masks in
+//   use, so all the managers in a program have to be used from one thread at a time.
+
+#ifndef RESMGR_HEADER_FILE
+#define RESMGR_HEADER_FILE
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "sizes.h"
+#include "banker.h"
+#include "queue.h"
+
+// Outcome of a request, or of retrying the oldest blocked one
+typedef enum {
+	resmgrGranted,		// The units were handed out
+	resmgrBlocked,		// Granting them would be unsafe; the request waits in the blocked queue
+	resmgrNothingBlocked,	// Retry only: the blocked queue is empty
+	resmgrInvalid		// Bad process index, or amounts that are negative or go past the claim
+} ResmgrResult;
+
+// Contention statistics for one resource type. Times are in the caller's units (OSS uses simulated ns).
+typedef struct {
+	int resource;
+	int requests;		// Requests received for it
+	int grants;		// Requests for it granted, straight away or after being blocked
+	int blocks;		// Requests for it blocked (a blocked request retried and denied again is not counted twice)
+	int safetyFailures;	// Blocked requests whose unsafe state had a stuck process short of this resource
+				//   (counted when the request is blocked, not again on each failed retry)
+	long long zeroAvailableTime;	// Time spent with none of the resource available
+	long long zeroSince;	// When availability last dropped to zero, -1 while some is available
+	int waitedGrants;	// Grants of blocked requests, for the average wait
+	long long totalWait;	// Time blocked requesters waited before being granted
+	long long maxWait;
+} ResourceStats;
+
+// Everything one resource manager decides with. Callers may read any of it; the tables are only
+//   written through the functions below, except when restoring a saved state (see resmgrSync()).
+typedef struct {
+	int total[maxResources];			// Units of each resource in the system
+	int available[maxResources];			// Units not allocated to anyone
+	int maximum[maxProcesses][maxResources];	// Max claim of each process
+	int allot[maxProcesses][maxResources];		// Units allocated to each process
+	int request[maxProcesses][maxResources];	// Last request of each process; still outstanding while blocked
+	long long requestTime[maxProcesses];		// When that request was made
+	bool live[maxProcesses];			// Registered and not yet terminated
+	bool blocked[maxProcesses];			// Waiting in the blocked queue
+	Queue *blockedQueue;				// Blocked processes, oldest first
+
+	SafetyKernel kernel;	// Banker's check in use (see resmgrSelectKernel())
+	SparseNeed sparse;	// Masks for the sparse check, kept in step with the tables when it is in use
+	bool verify;		// Check every decision against the generic check
+	int mismatches;		// Decisions the generic check disagreed with (only counted with verify)
+
+	// Statistics
+	int requests;
+	int grants;
+	int safetyChecks;
+	int releases;
+	int terminations;
+	ResourceStats resourceStats[maxResources];
+	bool dirtyRows[maxProcesses];	// Rows of allot changed since the caller last cleared them
+} ResourceManager;
+
+// Table sizes libresmgr.a was built with
+extern const int resmgrMaxProcesses;
+extern const int resmgrMaxResources;
+
+// Sets up a new manager, passing along the layout the caller was built with (see resmgrInitSized())
+#define resmgrInit( manager, total ) \
+	resmgrInitSized ( manager, total, sizeof ( ResourceManager ), maxProcesses, maxResources )
+
+/* Function Prototypes */
+bool resmgrInitSized ( ResourceManager *manager, int total[], size_t managerSize, int processes, int resources );
+void resmgrDestroy ( ResourceManager *manager );
+void resmgrReset ( ResourceManager *manager, int total[] );
+bool resmgrSelectKernel ( ResourceManager *manager, const char *choice, int largestClaim );
+void resmgrSync ( ResourceManager *manager, long long now );
+bool resmgrRegisterProcess ( ResourceManager *manager, int process, int claims[] );
+ResmgrResult resmgrRequest ( ResourceManager *manager, int process, int amounts[], long long now );
+ResmgrResult resmgrRetryBlocked ( ResourceManager *manager, long long now, int *process );
+bool resmgrRelease ( ResourceManager *manager, int process, int amounts[], long long now );
+bool resmgrTerminate ( ResourceManager *manager, int process, long long now );
+bool resmgrIsSafe ( ResourceManager *manager );
+bool resmgrIsBlocked ( ResourceManager *manager, int process );
+int resmgrBlockedCount ( ResourceManager *manager );
+int resmgrRequestedResource ( ResourceManager *manager, int process );
+
+#endif
@@ -0,0 +1,15 @@
+// File: simclock.c | Linked into: oss, bench
+//
+// Simulated clock arithmetic, split out of oss.c so the benchmarks can drive it too.
+
+#include "simclock.h"
+
+// Function that increments the clock by some amount of time at different points. 
+// Also makes sure that nanoseconds are converted to seconds when appropriate.
+void incrementClock ( unsigned int shmClock[] ) {
+	int processingTime = 5000; // Can be changed to adjust how much the clock is incremented.
+	shmClock[1] += processingTime;
+
+	shmClock[0] += shmClock[1] / 1000000000;
+	shmClock[1] = shmClock[1] % 1000000000;
+}
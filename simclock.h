@@ -0,0 +1,12 @@
+
+// File: simclock.h
+//
+// Header file for the simulated clock arithmetic (see simclock.c)
+
+#ifndef SIMCLOCK_HEADER_FILE
+#define SIMCLOCK_HEADER_FILE
+
+/* Function Prototypes */
+void incrementClock ( unsigned int shmClock[] );
+
+#endif
@@ -0,0 +1,22 @@
+
+// File: sizes.h
+//
+// Header file for the table sizes shared by OSS, USER and the resource manager library (libresmgr.a).
+// Kept apart from oss.h so a program linking libresmgr.a doesn't pull in the IPC layer.
+
+#ifndef SIZES_HEADER_FILE
+#define SIZES_HEADER_FILE
+
+// Number of process slots in every table. Can be overridden at build time like maxResources below
+//   (e.g. make CFLAGS+=-DmaxProcesses=4096) for large simulations.
+#ifndef maxProcesses
+#define maxProcesses 100
+#endif
+
+// Width of every resource vector and table row. Can be overridden at build time
+//   (e.g. make CFLAGS+=-DmaxResources=32) to exercise the wider banker kernels.
+#ifndef maxResources
+#define maxResources 20
+#endif
+
+#endif
@@ -0,0 +1,243 @@
+
+// File: sweep.c | Executable: sweep
+//
+// Parameter sweep driver for OSS.
+// Runs every combination of the given OSS options, several seeds each, as many at a time as
+// there are cores, and collects one CSV row per run (see resultCsvHeader in oss.h).
+
+#include "oss.h"
+
+#define maxListItems 32	// Most values accepted for a single swept option
+
+// One swept OSS option: the flag passed to OSS and the values to try
+typedef struct {
+	char flag[3];
+	char *values[maxListItems];
+	int count;
+} SweepList;
+
+void splitList ( SweepList *list, char *flag, char *text );
+void printUsage ( char *name );
+
+int main ( int argc, char *argv[] ) {
+	int i;
+	int option;
+	int seedsPerConfig = 3;	// Number of seeds each configuration is run with
+	int maxJobs = sysconf ( _SC_NPROCESSORS_ONLN );	// Runs allowed at once, one per core by default
+	char *runSeconds = "2";	// Passed to OSS with -t
+	char *workLimits[3][2] = { { "-e", NULL }, { "-T", NULL }, { "-c", NULL } };	// OSS's fixed-work run limits, passed on if given
+	char *outputName = "sweep.csv";	// Every run appends its row here
+	char *logDirectory = NULL;	// If set, each run keeps its logfile here; otherwise logs are discarded
+
+	// Swept options in the order they appear in the CSV. Each defaults to OSS's own default.
+	SweepList lists[7];
+	splitList ( &lists[0], "-p", "18" );
+	splitList ( &lists[1], "-m", "4" );
+	splitList ( &lists[2], "-n", "5000" );
+	splitList ( &lists[3], "-r", "1:10" );
+	splitList ( &lists[4], "-w", "45:45:10" );
+	splitList ( &lists[5], "-k", "auto" );
+	splitList ( &lists[6], "-W", "none" );
+
+	/* Command line options */
+	while ( ( option = getopt ( argc, argv, "hp:m:n:r:w:k:W:S:j:t:e:T:c:o:L:" ) ) != -1 ) {
+		switch ( option ) {
+			case 'h':
+				printUsage ( argv[0] );
+				return 0;
+			case 'p':
+				splitList ( &lists[0], "-p", optarg );
+				break;
+			case 'm':
+				splitList ( &lists[1], "-m", optarg );
+				break;
+			case 'n':
+				splitList ( &lists[2], "-n", optarg );
+				break;
+			case 'r':
+				splitList ( &lists[3], "-r", optarg );
+				break;
+			case 'w':
+				splitList ( &lists[4], "-w", optarg );
+				break;
+			case 'k':
+				splitList ( &lists[5], "-k", optarg );
+				break;
+			case 'W':
+				splitList ( &lists[6], "-W", optarg );
+				break;
+			case 'S':
+				seedsPerConfig = atoi ( optarg );
+				break;
+			case 'j':
+				maxJobs = atoi ( optarg );
+				break;
+			case 't':
+				runSeconds = optarg;
+				break;
+			case 'e':
+				workLimits[0][1] = optarg;
+				break;
+			case 'T':
+				workLimits[1][1] = optarg;
+				break;
+			case 'c':
+				workLimits[2][1] = optarg;
+				break;
+			case 'o':
+				outputName = optarg;
+				break;
+			case 'L':
+				logDirectory = optarg;
+				break;
+			default:
+				printUsage ( argv[0] );
+				return 1;
+		}
+	}
+
+	if ( seedsPerConfig < 1 || maxJobs < 1 ) {
+		fprintf ( stderr, "SWEEP: -S and -j must be at least 1.\n" );
+		return 1;
+	}
+
+	// Write the header. OSS appends the rows itself when each run ends.
+	FILE *outputFp = fopen ( outputName, "w" );
+	if ( outputFp == NULL ) {
+		perror ( "SWEEP: Failure to open the output file." );
+		return 1;
+	}
+	fprintf ( outputFp, "%s\n", resultCsvHeader );
+	fclose ( outputFp );
+
+	// Total number of runs in the grid
+	int totalRuns = seedsPerConfig;
+	for ( i = 0; i < 7; ++i ) {
+		totalRuns *= lists[i].count;
+	}
+
+	/* Main Loop */
+	// Each run number is decoded into one index per list plus a seed, so the grid is walked
+	//   without nested loops. Runs are started until maxJobs are alive, then one is reaped
+	//   before starting the next.
+	int run;
+	int running = 0;
+	int failedRuns = 0;
+	int status;
+	pid_t pid;
+
+	for ( run = 0; run < totalRuns || running > 0; ) {
+		if ( run < totalRuns && running < maxJobs ) {
+			char *ossArgs[40];
+			char seedBuffer[12];
+			char logBuffer[PATH_MAX];
+			int remainder = run;
+			int argCount = 0;
+
+			ossArgs[argCount++] = "oss";
+			for ( i = 0; i < 7; ++i ) {
+				ossArgs[argCount++] = lists[i].flag;
+				ossArgs[argCount++] = lists[i].values[remainder % lists[i].count];
+				remainder /= lists[i].count;
+			}
+			sprintf ( seedBuffer, "%d", remainder + 1 );	// Seeds 1..seedsPerConfig
+			if ( logDirectory != NULL )
+				snprintf ( logBuffer, sizeof ( logBuffer ), "%s/run%d.log", logDirectory, run );
+			else
+				strcpy ( logBuffer, "/dev/null" );
+
+			ossArgs[argCount++] = "-s";
+			ossArgs[argCount++] = seedBuffer;
+			ossArgs[argCount++] = "-t";
+			ossArgs[argCount++] = runSeconds;
+			for ( i = 0; i < 3; ++i ) {
+				if ( workLimits[i][1] != NULL ) {
+					ossArgs[argCount++] = workLimits[i][0];
+					ossArgs[argCount++] = workLimits[i][1];
+				}
+			}
+			ossArgs[argCount++] = "-l";
+			ossArgs[argCount++] = logBuffer;
+			// A discarded log must not stop the run at OSS's logfile line limit
+			if ( logDirectory == NULL ) {
+				ossArgs[argCount++] = "-L";
+				ossArgs[argCount++] = "0";
+			}
+			ossArgs[argCount++] = "-o";
+			ossArgs[argCount++] = outputName;
+			ossArgs[argCount] = NULL;
+
+			pid = fork();
+			if ( pid < 0 ) {
+				perror ( "SWEEP: Failure to fork OSS." );
+				break;
+			}
+
+			// In the child process: silence OSS's report and become OSS
+			if ( pid == 0 ) {
+				freopen ( "/dev/null", "w", stdout );
+				execv ( "./oss", ossArgs );
+				perror ( "SWEEP: Failure to exec OSS." );
+				exit ( 127 );
+			}
+
+			running++;
+			run++;
+			continue;
+		}
+
+		// At the job limit or out of runs: wait for one to finish
+		if ( wait ( &status ) > 0 ) {
+			running--;
+			if ( !WIFEXITED ( status ) || WEXITSTATUS ( status ) != 0 )
+				failedRuns++;
+			fprintf ( stderr, "SWEEP: %d of %d runs started, %d running\r", run, totalRuns, running );
+		} else {
+			break;
+		}
+	}
+
+	fprintf ( stderr, "\nSWEEP: %d runs finished (%d failed). Results in %s\n", run, failedRuns, outputName );
+
+	return failedRuns > 0;
+}
+
+// Fills a sweep list from a comma separated list of values
+void splitList ( SweepList *list, char *flag, char *text ) {
+	char *copy = strdup ( text );
+	char *token;
+
+	strcpy ( list->flag, flag );
+	list->count = 0;
+	for ( token = strtok ( copy, "," ); token != NULL && list->count < maxListItems; token = strtok ( NULL, "," ) ) {
+		list->values[list->count++] = token;
+	}
+
+	if ( list->count == 0 ) {
+		fprintf ( stderr, "SWEEP: %s needs at least one value.\n", flag );
+		exit ( 1 );
+	}
+}
+
+// Prints the command line options
+void printUsage ( char *name ) {
+	printf ( "Usage: %s [options]\n", name );
+	printf ( "Each of -p -m -n -r -w -k -W takes a comma separated list of values for that OSS option.\n" );
+	printf ( "Every combination is run once per seed.\n" );
+	printf ( "\t-p LIST\tMax USER processes alive at once (default 18)\n" );
+	printf ( "\t-m LIST\tMax claim bound (default 4)\n" );
+	printf ( "\t-n LIST\tSimulated time bound between new processes (default 5000)\n" );
+	printf ( "\t-r LIST\tResource total ranges, LOW:HIGH (default 1:10)\n" );
+	printf ( "\t-w LIST\tUSER action percentages, REQ:REL:TERM (default 45:45:10)\n" );
+	printf ( "\t-k LIST\tBanker's safety check: auto, sparse, queued, dense, generic (default auto)\n" );
+	printf ( "\t-W LIST\tWorkload profile files, or none (default none)\n" );
+	printf ( "\t-S N\tSeeds per configuration (default 3)\n" );
+	printf ( "\t-j N\tRuns at once (default number of cores)\n" );
+	printf ( "\t-t SEC\tReal seconds per run, 0 for no limit (default 2)\n" );
+	printf ( "\t-e N\tMessages processed per run, passed to OSS (default no limit)\n" );
+	printf ( "\t-T SEC\tSimulated seconds per run, passed to OSS (default no limit)\n" );
+	printf ( "\t-c N\tProcesses completed per run, passed to OSS (default no limit)\n" );
+	printf ( "\tWith -e, -T or -c (and -t 0) runs are compared by the work done rather than by real time.\n" );
+	printf ( "\t-o FILE\tCSV output (default sweep.csv)\n" );
+	printf ( "\t-L DIR\tKeep each run's logfile in DIR, under OSS's line limit (default discard, with no line limit)\n" );
+}
@@ -0,0 +1,48 @@
+
+// File: trace.h
+//
+// Static tracepoints (USDT probes) at the resource manager's decision points in oss.c and resmgr.c,
+// and where logstream.c hands a block of the logfile to its writer thread.
+// Built with make TRACE=1 (which defines OSS_USDT) the probes show up to perf and bpftrace
+// under the "oss" provider, e.g.
+//     bpftrace -e 'usdt:./oss:oss:block { @[arg1] = count(); }'
+// Without it every probe compiles to nothing.
+//
+// Probes and arguments (simulated time is seconds, nanoseconds):
+//     message_receive	index, resource, seconds, nanoseconds	(resource is -1 for a termination)
+//     safety_start	index, resource, seconds, nanoseconds
+//     safety_end	index, resource, seconds, nanoseconds, safe, passes over the process table
+//     grant		index, resource, seconds, nanoseconds
+//     block		index, resource, seconds, nanoseconds
+//     unblock		index, resource, seconds, nanoseconds
+//     release		index, resource, seconds, nanoseconds
+//     terminate	index, -1, seconds, nanoseconds
+//     spawn		index, pid, seconds, nanoseconds
+//     log_flush	bytes in the block, bytes in the logfile so far, lines so far, 1 if the block ends a segment
+
+#ifndef TRACE_HEADER_FILE
+#define TRACE_HEADER_FILE
+
+#ifdef OSS_USDT
+
+#if defined ( __has_include )
+#if !__has_include ( <sys/sdt.h> )
+#error "TRACE=1 needs <sys/sdt.h> (systemtap-sdt-dev / systemtap-sdt-devel)"
+#endif
+#endif
+
+#include <sys/sdt.h>
+
+#define OSS_TRACE( name, index, resource, seconds, nanoseconds ) \
+	DTRACE_PROBE4 ( oss, name, index, resource, seconds, nanoseconds )
+#define OSS_TRACE_SAFETY_END( index, resource, seconds, nanoseconds, safe, passes ) \
+	DTRACE_PROBE6 ( oss, safety_end, index, resource, seconds, nanoseconds, safe, passes )
+
+#else
+
+#define OSS_TRACE( name, index, resource, seconds, nanoseconds ) do { } while ( 0 )
+#define OSS_TRACE_SAFETY_END( index, resource, seconds, nanoseconds, safe, passes ) do { } while ( 0 )
+
+#endif
+
+#endif
@@ -5,22 +5,39 @@
 // USER process that requests and releases resources.
 // Generated and managed by OSS. 
 
+#include <math.h>
+
 #include "oss.h"
+#include "profile.h"
+
+/* Message Queue Variables */
+Message message;
+int messageID;
+key_t messageKey;
+
+/* Shared Memory Variables */
+int shmRegionID;
+SharedRegion *shmRegion;
+key_t shmRegionKey;
+unsigned int *shmClock;
 
 bool hasResourcesToRelease ( int arr[] );
 bool canRequestMore ( int arr1[], int arr2[] );
+int pickRequestResource ( double weights[], int maxClaim[], int allocated[] );
+int pickReleaseResource ( int allocated[], unsigned long long grantTime[], unsigned int holdTime );
+unsigned long long simulatedNow ();
 
 int main ( int argc, char *argv[] ) {
 	/* General variables */
 	int i, j; 			// Loop index variables
-	int totalProcessLimit = 100;	// Needs to match the value from OSS
 	int myPid = getpid();		// Store process ID for self-identification
 	int ossPid = getppid();		// Store parent process ID for sending messages
 	int processIndex;		// Store the index passed with exec from OSS. This will always be included
 					//   when sending messages to easily find the associated row in the various
 					//   resources tables in OSS.
-	int maxClaimVector[20];		// Store the max claim vector sent from OSS.
-	int allocatedVector[20];	// Store the amount of each resource ( 0-19 ) currently allocated to this USER
+	ProcessControl *control;	// This USER's control block in shared memory
+	int maxClaimVector[maxResources];	// Store the max claim vector sent from OSS.
+	int allocatedVector[maxResources];	// Store the amount of each resource ( 0 to maxResources-1 ) currently allocated to this USER
 					
 	/* Signal handling */
 	if ( signal ( SIGINT, handle ) == SIG_ERR ) {
@@ -28,97 +45,109 @@ int main ( int argc, char *argv[] ) {
 	}
 	
 	/* Shared memory */
-	// Access shared memory segments
-	shmClockKey = 1993;
-	if ( ( shmClockID = shmget ( shmClockKey, ( 2 * ( sizeof ( unsigned int ) ) ), 0666 ) ) == -1 ) {
-		perror ( "USER: Failure to find shared memory space for simulated clock." );
+	// Access the shared memory region. Its key is derived from the instance ID of the OSS that
+	//   spawned this USER, passed after the process index.
+	int ossInstance = atoi ( argv[maxResources + 2] );
+	shmRegionKey = ipcKey ( ossInstance, ipcRegionObject );
+	if ( ( shmRegionID = shmget ( shmRegionKey, 0, 0666 ) ) == -1 ) {
+		perror ( "USER: Failure to find shared memory region." );
 		return 1;
 	}
 	
-	if ( ( shmClock = (unsigned int *) shmat ( shmClockID, NULL, 0 ) ) < 0 ) {
-		perror ( "USER: Failure to attach to shared memory space for simulated clock." );
-		return 1;
-	}
-
-	shmBlockedKey = 1994;
-	if ( ( shmBlockedID = shmget ( shmBlockedKey, ( totalProcessLimit * ( sizeof ( int ) ) ), 0666 ) ) == -1 ) {
-		perror ( "USER: Failure to find shared memory space for blocked USER process array." );
+	if ( ( shmRegion = (SharedRegion *) shmat ( shmRegionID, NULL, 0 ) ) == (void *) -1 ) {
+		perror ( "USER: Failure to attach to shared memory region." );
 		return 1;
 	}
 	
-	if ( ( shmBlocked = (int *) shmat ( shmBlockedID, NULL, 0 ) ) < 0 ) {
-		perror ( "USER: Failure to attach to shared memory space for blocked USER process array." );
+	// The region must have been laid out by an OSS built with the same tables as this USER
+	if ( shmRegion->header.magic != sharedRegionMagic || shmRegion->header.version != sharedRegionVersion ||
+	     shmRegion->header.regionSize != sizeof ( SharedRegion ) ||
+	     shmRegion->header.processSlots != maxProcesses || shmRegion->header.resourceTypes != maxResources ) {
+		fprintf ( stderr, "USER: Shared memory region does not match this build (rebuild OSS and USER together).\n" );
 		return 1;
 	}
+	shmClock = shmRegion->clock.time;
+	if ( !shmRegion->header.profiling )
+		profileDisable();
 	
 	/* Message queue */
 	// Access message queue
-	messageKey = 1996;
-	if ( ( messageID = msgget ( messageKey, IPC_CREAT | 0666 ) ) == -1 ) {
-		perror ( "USER: Failure to create the message queue." );
+	messageKey = ipcKey ( ossInstance, ipcMessageObject );
+	if ( ( messageID = msgget ( messageKey, 0666 ) ) == -1 ) {
+		perror ( "USER: Failure to find the message queue." );
 		return 1;
 	}
 	
 	/* Establish USER-specific seed for generating random numbers */
-	time_t processSeed; 
-	srand ( ( int ) time ( &processSeed ) % getpid() );
+	// OSS derives it from its run seed and this process's index so runs can be repeated.
+	srand ( strtoul ( argv[maxResources + 6], NULL, 10 ) );
 	
 	/* Constants for determining probability of request, release, or terminate */
-	// Values can be tuned to get desired output
+	// Percentages are passed from OSS (-w option there). Each action owns a band of 1-100:
+	//   terminate 1-terminateProb, release up to releaseProb, request up to requestProb.
 	const int probUpper = 100;
 	const int probLower = 1;
-	const int requestProb = 100;
-	const int releaseProb = 55;
-	const int terminateProb = 10;
+	const int terminateProb = atoi ( argv[maxResources + 5] );
+	const int releaseProb = terminateProb + atoi ( argv[maxResources + 4] );
+	const int requestProb = releaseProb + atoi ( argv[maxResources + 3] );
 	
 	/* Storing of passed arguments from OSS to get process index and max resource claim vector */
-	maxClaimVector[0] = atoi ( argv[1] );
-	maxClaimVector[1] = atoi ( argv[2] );
-	maxClaimVector[2] = atoi ( argv[3] );
-	maxClaimVector[3] = atoi ( argv[4] );
-	maxClaimVector[4] = atoi ( argv[5] );
-	maxClaimVector[5] = atoi ( argv[6] );
-	maxClaimVector[6] = atoi ( argv[7] );
-	maxClaimVector[7] = atoi ( argv[8] );
-	maxClaimVector[8] = atoi ( argv[9] );
-	maxClaimVector[9] = atoi ( argv[10] );
-	maxClaimVector[10] = atoi ( argv[11] );
-	maxClaimVector[11] = atoi ( argv[12] );
-	maxClaimVector[12] = atoi ( argv[13] );
-	maxClaimVector[13] = atoi ( argv[14] );
-	maxClaimVector[14] = atoi ( argv[15] );
-	maxClaimVector[15] = atoi ( argv[16] );
-	maxClaimVector[16] = atoi ( argv[17] );
-	maxClaimVector[17] = atoi ( argv[18] );
-	maxClaimVector[18] = atoi ( argv[19] );
-	maxClaimVector[19] = atoi ( argv[20] );
-	processIndex = atoi ( argv[21] );
+	for ( i = 0; i < maxResources; ++i ) {
+		maxClaimVector[i] = atoi ( argv[i + 1] );
+	}
+	processIndex = atoi ( argv[maxResources + 1] );
+	control = &shmRegion->process[processIndex];
+	UserProfile *profile = &shmRegion->profile[processIndex];	// This USER's request path totals (see profile.c)
 	
 	//printf ( "Hello, from a %d process.\n", myPid );
 	//printf ( "%d: Process %d\n", myPid, processIndex );
-	//for ( i = 0; i < 20; ++i ) {
+	//for ( i = 0; i < maxResources; ++i ) {
 	//	printf ( "R%d: %d ", i, maxClaimVector[i] );
 	//}
 	//printf ( "\n" );
 	
 	/* Initialize allocated vector to 0 */
-	for ( i = 0; i < 20; ++i ) {
-		allocatedVector[i] = 0;
+	// A USER respawned from a checkpoint is also passed what it held (argv[maxResources+7] onwards)
+	//   and the request it was blocked on, -1 if none.
+	bool restored = ( argc == 2 * maxResources + 8 );
+	for ( i = 0; i < maxResources; ++i ) {
+		allocatedVector[i] = restored ? atoi ( argv[maxResources + 7 + i] ) : 0;
 	}
 	
 	/* Variables for main loop */
 	bool waitingOnRequest = false;	// Flag to prevent USER from requesting another resource 
 					//   while still waiting on a previous request.
+	if ( restored && atoi ( argv[2 * maxResources + 7] ) != -1 )
+		waitingOnRequest = true;
 	int randomAction;	// Will store the random number to decide what action to take
 	int selectedResource;	// Will store the resource that USER wants to request or release
-	bool validResource;	// Flag to indicate if the resource is okay to request or release
+	long long phaseStart;	// Real time the current request path phase started
+	long long requestSent = profileClock();	// Real time the outstanding request was sent (a restored
+						//   USER counts its wait from when it started)
+	bool received;
+	
+	/* Workload */
+	// Handed over by OSS in the control block (see workload.c). Without a profile everything is
+	//   zero: uniform resource choice, no bursts, no hold or think time.
+	Workload workload = control->workload;
+	double resourceWeights[maxResources];	// Relative popularity of each resource
+	unsigned long long grantTime[maxResources];	// Simulated time each resource was last granted
+	unsigned long long nextActionTime = 0;	// Simulated time before which USER thinks instead of acting
+	int burstRemaining = 0;	// Requests left in the current burst
+	
+	for ( i = 0; i < maxResources; ++i ) {
+		resourceWeights[i] = workload.zipfExponent > 0 ? pow ( i + 1, -workload.zipfExponent ) : 1.0;
+		grantTime[i] = 0;
+	}
 	
 	// Enter main loop
 	while ( 1 ) {
 		
-		// If the process is not in the blocked queue in OSS (indicated by shared memory) and 
-		//   the process is not waiting on OSS to respond to a resource request
-		if ( shmBlocked[processIndex] == 0 && waitingOnRequest == false ) { 
+		// If the process is not in the blocked queue in OSS (indicated by shared memory), 
+		//   the process is not waiting on OSS to respond to a resource request and it is
+		//   done thinking since its last action
+		if ( control->blocked == 0 && waitingOnRequest == false && simulatedNow() >= nextActionTime ) { 
+			phaseStart = profileClock();
 			
 			// Check to see if it still needs to resources. If has been allocated enough resources
 			//   to match the max claim vector, then it can do it task and terminate.
@@ -127,8 +156,8 @@ int main ( int argc, char *argv[] ) {
 				message.msg_type = 5;
 				message.pid = myPid;
 				message.tableIndex = processIndex;
-				message.request = 0;
-				message.release = 0;
+				message.request = -1;
+				message.release = -1;
 				message.terminate = true;
 				message.resourceGranted = false;
 				message.messageTime[0] = shmClock[0];
@@ -146,19 +175,20 @@ int main ( int argc, char *argv[] ) {
 			
 			// If process can still request resources, continue...
 			randomAction = ( rand() % ( probUpper - probLower + 1 ) + probLower );
+			nextActionTime = simulatedNow() + workload.thinkTime;
+			
+			// A burst turns the next burstLength actions into requests
+			if ( burstRemaining == 0 && workload.burstChance > 0 && rand() % 100 < workload.burstChance )
+				burstRemaining = workload.burstLength;
+			if ( burstRemaining > 0 ) {
+				randomAction = requestProb;
+				burstRemaining--;
+			}
 			
 			// Request Resource
 			if ( randomAction > releaseProb && randomAction <= requestProb ) {
-				validResource = false;
-				
-				// Check to make sure the selected resource isn't already maxed out. If it is, 
-				//   select a different resource to request.
-				while ( validResource == false ) {
-					selectedResource = ( rand() % ( 19 - 0 + 1 ) + 0 );
-					if ( allocatedVector[selectedResource] < maxClaimVector[selectedResource] ) {
-						validResource = true;
-					} 
-				} // End of select a valid resource loop
+				// Pick by popularity among the resources that aren't already maxed out
+				selectedResource = pickRequestResource ( resourceWeights, maxClaimVector, allocatedVector );
 				
 				// Set message outgoing message information and send message
 				message.msg_type = 5;
@@ -170,10 +200,13 @@ int main ( int argc, char *argv[] ) {
 				message.resourceGranted = false;
 				message.messageTime[0] = shmClock[0];
 				message.messageTime[1] = shmClock[1];
+				control->pendingRequest = selectedResource;
+				phaseStart = userProfileAdd ( profile, userPhaseDecide, phaseStart );
 					    
 				if ( msgsnd ( messageID, &message, sizeof ( message ), 0 ) == -1 ) {
 					perror ( "USER: Failure to send message." );
 				}
+				requestSent = userProfileAdd ( profile, userPhaseSend, phaseStart );
 				
 				// Flag can only be set back to false later if a received message indicates that the
 				//   above request was granted by OSS. 
@@ -182,18 +215,12 @@ int main ( int argc, char *argv[] ) {
 			
 			// Release Resource
 			if ( randomAction > terminateProb && randomAction <= releaseProb ) {
-				validResource = false;
-				
-				// Check to make sure that USER currently has resources to release.
-				// If it does, check to make sure it selects a valid resource.
-				if ( hasResourcesToRelease ( allocatedVector ) ) {
-					while ( validResource == false ) {
-						selectedResource = ( rand() % ( 19 - 0 + 1 ) + 0 );
-						if ( allocatedVector[selectedResource] > 0 ) {
-							validResource = true;
-						} 
-					} // End of selected a valid resource loop
-					
+				// Check to make sure that USER currently has resources to release that it has held
+				//   for at least the hold time. If it does, pick one of them.
+				selectedResource = -1;
+				if ( hasResourcesToRelease ( allocatedVector ) )
+					selectedResource = pickReleaseResource ( allocatedVector, grantTime, workload.holdTime );
+				if ( selectedResource != -1 ) {
 					// Set message outgoing message information and send message
 					message.msg_type = 5;
 					message.pid = myPid;
@@ -210,7 +237,7 @@ int main ( int argc, char *argv[] ) {
 					}	
 					
 					allocatedVector[selectedResource]--;
-				} // End of select a valid resource loop	    		    
+				} // End of release of a held resource
 			} // End of release resource
 			
 			// Terminate
@@ -238,13 +265,23 @@ int main ( int argc, char *argv[] ) {
 		} // End of action loop
 		
 		// Check to see if OSS has responded to any resource requests for this process
-		msgrcv ( messageID, &message, sizeof ( message ), myPid, IPC_NOWAIT );
-				    
 		// If a resource request was granted by OSS, reset waitingOnRequest flag and increase
 		//   the amount of that resource in the allocated resource vector.
-		if ( message.resourceGranted == true ) {
-			waitingOnRequest = false;
-			allocatedVector[selectedResource]++;
+		if ( waitingOnRequest == true ) {
+			phaseStart = profileClock();
+			received = msgrcv ( messageID, &message, sizeof ( message ), myPid, IPC_NOWAIT ) != -1;
+			userProfileAdd ( profile, userPhasePoll, phaseStart );
+			if ( received && message.resourceGranted == true ) {
+				userProfileAdd ( profile, userPhaseWait, requestSent );
+				waitingOnRequest = false;
+				control->pendingRequest = -1;
+				allocatedVector[control->replyResource]++;	// OSS filled the reply slot before sending
+				grantTime[control->replyResource] = control->replyTime[0] * 1000000000ULL + control->replyTime[1];
+			} else if ( received ) {
+				// OSS refused the request outright; it was never queued, so stop waiting on it
+				waitingOnRequest = false;
+				control->pendingRequest = -1;
+			}
 		}
 	
 	} // End of main loop
@@ -259,13 +296,58 @@ void handle ( int sig_num ) {
 	}
 }
 
+// Returns the current simulated time in nanoseconds
+unsigned long long simulatedNow () {
+	return shmClock[0] * 1000000000ULL + shmClock[1];
+}
+
+// Picks a resource to request, in proportion to its weight, among those still below the max claim.
+// The caller makes sure there is at least one (canRequestMore()).
+int pickRequestResource ( double weights[], int maxClaim[], int allocated[] ) {
+	double total = 0.0;
+	double pick;
+	int i, last = -1;
+	
+	for ( i = 0; i < maxResources; ++i ) {
+		if ( allocated[i] < maxClaim[i] )
+			total += weights[i];
+	}
+	
+	pick = ( double ) rand() / ( ( double ) RAND_MAX + 1.0 ) * total;
+	for ( i = 0; i < maxResources; ++i ) {
+		if ( allocated[i] >= maxClaim[i] )
+			continue;
+		last = i;
+		if ( pick < weights[i] )
+			break;
+		pick -= weights[i];
+	}
+	
+	return i < maxResources ? i : last;	// Rounding can run off the end
+}
+
+// Picks a held resource at random among those held for at least holdTime, or -1 if there are none
+int pickReleaseResource ( int allocated[], unsigned long long grantTime[], unsigned int holdTime ) {
+	unsigned long long now = simulatedNow();
+	int candidates[maxResources];
+	int count = 0;
+	int i;
+	
+	for ( i = 0; i < maxResources; ++i ) {
+		if ( allocated[i] > 0 && now >= grantTime[i] + holdTime )
+			candidates[count++] = i;
+	}
+	
+	return count > 0 ? candidates[rand() % count] : -1;
+}
+
 // Returns true is allocated resource vector has less resources in total than the max claim vector allows
 bool canRequestMore ( int arr1[], int arr2[] ) {
 	int i;
 	int sum1 = 0;
 	int sum2 = 0;
 	
-	for ( i = 0; i < 20; ++i ) {
+	for ( i = 0; i < maxResources; ++i ) {
 		sum1 += arr1[i];	// Total resources in max claim vector
 		sum2 += arr2[i];	// Total resources in allocated resource vector
 	}
@@ -280,7 +362,7 @@ bool canRequestMore ( int arr1[], int arr2[] ) {
 bool hasResourcesToRelease ( int arr[] ) {
 	int i;
 	int sum = 0;
-	for ( i = 0; i < 20; ++i ) {
+	for ( i = 0; i < maxResources; ++i ) {
 		sum += arr[i];
 	}
 	
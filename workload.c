@@ -0,0 +1,121 @@
+// File: workload.c | Linked into: oss
+//
+// Workload profiles for USER processes.
+// A profile file mixes several client classes in one run. Each line that isn't blank or a
+// # comment describes one class:
+//
+//     class NAME [weight=N] [actions=REQ:REL:TERM] [zipf=S] [burst=CHANCE:LENGTH] [hold=NS] [think=NS]
+//
+//     weight	relative share of spawned USERs in this class (default 1)
+//     actions	percent chance of a request, release or termination on each action (default 45:45:10)
+//     zipf	resource popularity skew; resource r is picked with weight 1/(r+1)^S (default 0, uniform)
+//     burst	percent chance on each action of starting a burst of LENGTH back to back requests
+//     hold	simulated nanoseconds a granted resource is held before it may be released
+//     think	simulated nanoseconds between actions
+//
+// OSS picks a class for every USER it spawns (by weight) and hands it over in the USER's
+// control block in shared memory.
+
+#include "workload.h"
+
+// Reads a profile into classes. Returns the number of classes, or -1 (after printing why) if the
+//   file can't be read or has a line it doesn't understand.
+int loadWorkloadProfile ( const char *name, WorkloadClass classes[] ) {
+	FILE *profile;
+	char line[512];
+	char *token;
+	int lineNumber = 0;
+	int classCount = 0;
+	WorkloadClass *current;
+
+	if ( ( profile = fopen ( name, "r" ) ) == NULL ) {
+		perror ( "OSS: Failure to open the workload profile." );
+		return -1;
+	}
+
+	while ( fgets ( line, sizeof ( line ), profile ) != NULL ) {
+		lineNumber++;
+		if ( ( token = strchr ( line, '#' ) ) != NULL )
+			*token = '\0';
+		if ( ( token = strtok ( line, " \t\r\n" ) ) == NULL )
+			continue;
+
+		if ( strcmp ( token, "class" ) != 0 || ( token = strtok ( NULL, " \t\r\n" ) ) == NULL ) {
+			fprintf ( stderr, "OSS: %s:%d: expected \"class NAME ...\".\n", name, lineNumber );
+			fclose ( profile );
+			return -1;
+		}
+		if ( classCount == maxWorkloadClasses ) {
+			fprintf ( stderr, "OSS: %s:%d: at most %d classes are allowed.\n", name, lineNumber, maxWorkloadClasses );
+			fclose ( profile );
+			return -1;
+		}
+
+		// Defaults match USER's behaviour without a profile
+		current = &classes[classCount];
+		memset ( current, 0, sizeof ( WorkloadClass ) );
+		snprintf ( current->name, sizeof ( current->name ), "%s", token );
+		current->weight = 1;
+		current->requestPercent = 45;
+		current->releasePercent = 45;
+		current->terminatePercent = 10;
+		current->workload.classIndex = classCount;
+
+		while ( ( token = strtok ( NULL, " \t\r\n" ) ) != NULL ) {
+			bool valid;
+
+			if ( strncmp ( token, "weight=", 7 ) == 0 )
+				valid = sscanf ( token + 7, "%d", &current->weight ) == 1 && current->weight > 0;
+			else if ( strncmp ( token, "actions=", 8 ) == 0 )
+				valid = sscanf ( token + 8, "%d:%d:%d", &current->requestPercent, &current->releasePercent,
+						 &current->terminatePercent ) == 3 &&
+					current->requestPercent >= 0 && current->releasePercent >= 0 && current->terminatePercent >= 0 &&
+					current->requestPercent + current->releasePercent + current->terminatePercent == 100;
+			else if ( strncmp ( token, "zipf=", 5 ) == 0 )
+				valid = sscanf ( token + 5, "%f", &current->workload.zipfExponent ) == 1 && current->workload.zipfExponent >= 0;
+			else if ( strncmp ( token, "burst=", 6 ) == 0 )
+				valid = sscanf ( token + 6, "%d:%d", &current->workload.burstChance, &current->workload.burstLength ) == 2 &&
+					current->workload.burstChance >= 0 && current->workload.burstChance <= 100 && current->workload.burstLength >= 0;
+			else if ( strncmp ( token, "hold=", 5 ) == 0 )
+				valid = sscanf ( token + 5, "%u", &current->workload.holdTime ) == 1;
+			else if ( strncmp ( token, "think=", 6 ) == 0 )
+				valid = sscanf ( token + 6, "%u", &current->workload.thinkTime ) == 1;
+			else
+				valid = false;
+
+			if ( !valid ) {
+				fprintf ( stderr, "OSS: %s:%d: bad setting \"%s\".\n", name, lineNumber, token );
+				fclose ( profile );
+				return -1;
+			}
+		}
+
+		classCount++;
+	}
+
+	fclose ( profile );
+	if ( classCount == 0 ) {
+		fprintf ( stderr, "OSS: %s has no classes.\n", name );
+		return -1;
+	}
+	return classCount;
+}
+
+// Picks a class at random, in proportion to the class weights
+int pickWorkloadClass ( WorkloadClass classes[], int classCount ) {
+	int totalWeight = 0;
+	int pick;
+	int i;
+
+	for ( i = 0; i < classCount; ++i ) {
+		totalWeight += classes[i].weight;
+	}
+
+	pick = rand() % totalWeight;
+	for ( i = 0; i < classCount - 1; ++i ) {
+		if ( pick < classes[i].weight )
+			break;
+		pick -= classes[i].weight;
+	}
+	return i;
+}
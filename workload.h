@@ -0,0 +1,27 @@
+
+// File: workload.h
+//
+// Header file for USER workload profiles (see workload.c)
+
+#ifndef WORKLOAD_HEADER_FILE
+#define WORKLOAD_HEADER_FILE
+
+#include "oss.h"
+
+#define maxWorkloadClasses 16	// Most client classes one profile can mix
+
+// A client class from a workload profile
+typedef struct {
+	char name[32];
+	int weight;		// Relative share of spawned USERs that get this class
+	int requestPercent;	// Chance of each USER action, adding up to 100
+	int releasePercent;
+	int terminatePercent;
+	Workload workload;	// Copied into the USER's control block at spawn
+} WorkloadClass;
+
+/* Function Prototypes */
+int loadWorkloadProfile ( const char *name, WorkloadClass classes[] );
+int pickWorkloadClass ( WorkloadClass classes[], int classCount );
+
+#endif